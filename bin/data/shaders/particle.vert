@@ -1,10 +1,11 @@
 #version 150
 
 uniform mat4 modelViewProjectionMatrix;
-in vec4 position;
+in vec4 position;   // only x is used, y arrives in its own stream
+in float py;
 uniform float size;
 
 void main() {
-	gl_Position = modelViewProjectionMatrix * position;
+	gl_Position = modelViewProjectionMatrix * vec4(position.x, py, 0.0, 1.0);
     gl_PointSize = size;
 }
@@ -0,0 +1,56 @@
+#include "attractorBins.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const int maxCellsPerSide = 256;
+    const float minCellSize = 16.0f;
+}
+
+bool attractorBins::update(const std::vector<gaussianWell>& wells, float width, float height, float cutoffSigmas) {
+    if (width == builtWidth && height == builtHeight && cutoffSigmas == builtCutoff && sameWells(wells, builtWells)) {
+        return false;
+    }
+    builtWells = wells;
+    builtWidth = width;
+    builtHeight = height;
+    builtCutoff = cutoffSigmas;
+
+    // Cells about the size of the smallest cutoff disk, so a well covers a handful of cells
+    float minReach = 0;
+    for (const auto& well : wells) {
+        float reach = cutoffSigmas * std::sqrt(-0.5f * well.expDenominator);
+        if (reach > 0 && (minReach == 0 || reach < minReach)) minReach = reach;
+    }
+    cellSize = std::max(minReach, minCellSize);
+    cellSize = std::max(cellSize, std::max(width, height) / maxCellsPerSide);
+    inverseCellSize = 1.0f / cellSize;
+    columns = std::max(1, int(std::ceil(width * inverseCellSize)));
+    rows = std::max(1, int(std::ceil(height * inverseCellSize)));
+
+    // Two passes (count, then fill) so the lists live in one flat array.
+    // Particles are kept inside the window by the wall reflection, so disks are clipped to it.
+    std::vector<uint32_t> counts(size_t(columns) * rows + 1, 0);
+    auto forEachCell = [&](const gaussianWell& well, uint32_t k, bool fill) {
+        float reach = cutoffSigmas * std::sqrt(-0.5f * well.expDenominator);
+        int i0 = std::max(0, int(std::floor((well.cx - reach) * inverseCellSize)));
+        int i1 = std::min(columns - 1, int(std::floor((well.cx + reach) * inverseCellSize)));
+        int j0 = std::max(0, int(std::floor((well.cy - reach) * inverseCellSize)));
+        int j1 = std::min(rows - 1, int(std::floor((well.cy + reach) * inverseCellSize)));
+        for (int j = j0; j <= j1; ++j) {
+            for (int i = i0; i <= i1; ++i) {
+                size_t cell = size_t(j) * columns + i;
+                if (fill) cellEntries[counts[cell]++] = k;
+                else counts[cell + 1]++;
+            }
+        }
+    };
+    for (uint32_t k = 0; k < wells.size(); ++k) forEachCell(wells[k], k, false);
+    for (size_t c = 1; c < counts.size(); ++c) counts[c] += counts[c - 1];
+    cellStart = counts;
+    cellEntries.resize(counts.back());
+    for (uint32_t k = 0; k < wells.size(); ++k) forEachCell(wells[k], k, true);
+    cellWellData.resize(cellEntries.size());
+    for (size_t e = 0; e < cellEntries.size(); ++e) cellWellData[e] = wells[cellEntries[e]];
+    return true;
+}
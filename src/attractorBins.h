@@ -0,0 +1,44 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "forceKernel.h"
+
+// Uniform grid over the window listing, for every cell, the attractors whose cutoff disk (k sigma) overlaps it.
+// With k around 14.5 every skipped Gaussian has already underflowed to 0 in float, so culling changes nothing;
+// smaller k trades accuracy for speed.
+class attractorBins {
+public:
+    // Rebuilds the lists if the wells, the domain or k changed; returns true if it did
+    bool update(const std::vector<gaussianWell>& wells, float width, float height, float cutoffSigmas);
+
+    // Cell holding (x, y); points outside the window go to the nearest edge cell
+    uint32_t cellOf(float x, float y) const {
+        int i = std::min(std::max(int(std::floor(x * inverseCellSize)), 0), columns - 1);
+        int j = std::min(std::max(int(std::floor(y * inverseCellSize)), 0), rows - 1);
+        return uint32_t(j) * columns + i;
+    }
+    // The attractors that can reach cell, in their original order so the force sum keeps its order
+    const gaussianWell* cellWells(uint32_t cell, size_t& count) const {
+        count = cellStart[cell + 1] - cellStart[cell];
+        return cellWellData.data() + cellStart[cell];
+    }
+
+    size_t wellCount() const { return builtWells.size(); }
+
+private:
+    float cellSize = 64;
+    float inverseCellSize = 1.0f / 64;
+    int columns = 0;
+    int rows = 0;
+    std::vector<uint32_t> cellStart;    // cellStart[c]..cellStart[c+1] indexes cellEntries
+    std::vector<uint32_t> cellEntries;  // attractor indices, ascending within a cell
+    std::vector<gaussianWell> cellWellData; // the wells cellEntries points at, packed for the force kernel
+
+    std::vector<gaussianWell> builtWells;
+    float builtWidth = -1;
+    float builtHeight = -1;
+    float builtCutoff = -1;
+};
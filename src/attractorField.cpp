@@ -1,4 +1,5 @@
 #include "attractorField.h"
+#include "traceRecorder.h"
 #include <cmath>
 #include <algorithm>
 
@@ -21,103 +22,209 @@ void attractorField::draw() const {
 
 void attractorField::drawContours() const {
 //    ofSetColor(0, 0, 255); // Red color for contour lines
-    ofFill();
-    for (const auto& point : contourPoints) {
-        ofDrawCircle(point.x, point.y, 0.8); // Smaller size for higher resolution
+    for (const auto& line : contourLines) {
+        line.draw();
     }
 }
 
 void attractorField::updateContours(float downscaleFactor, int width, int height, const std::vector<glm::vec3>& equidistantPoints, float contourThreshold) {
-    contourPoints.clear();
-    
-    for (int y = 1; y < height; ++y) {
-        for (int x = 1; x < width; ++x) {
-            float potential = computePotentialAtPoint(x * downscaleFactor, y * downscaleFactor);
-            float potentialRight = computePotentialAtPoint((x + 1) * downscaleFactor, y * downscaleFactor);
-            float potentialDown = computePotentialAtPoint(x * downscaleFactor, (y + 1) * downscaleFactor);
-
-            if ((potential >= contourThreshold && potentialRight < contourThreshold) ||
-                (potential < contourThreshold && potentialRight >= contourThreshold) ||
-                (potential >= contourThreshold && potentialDown < contourThreshold) ||
-                (potential < contourThreshold && potentialDown >= contourThreshold)) {
-                contourPoints.emplace_back(x * downscaleFactor, y * downscaleFactor);
-            }
-        }
+    updateContours(downscaleFactor, width, height, std::vector<float>{contourThreshold});
+}
+
+void attractorField::updateContours(float downscaleFactor, int width, int height, const std::vector<float>& contourThresholds) {
+    traceRecorder::scope trace("updateContours");
+    // Contours are traced on the same grid the potential field image is built from
+    if (syncPotentialGrid(downscaleFactor, width, height)) {
+        displayedMaxPotential = -1;  // the image has not seen these changes yet, repaint it on the next calculatePotentialField
     }
+    contourLines.clear();
+    contourExtractor.extract(potentialGrid, width, height, downscaleFactor, contourThresholds, contourLines, pool);
 }
 
 void attractorField::calculatePotentialField(ofImage& potentialField, float downscaleFactor, int width, int height, float contourThreshold) {
-    float maxPotential = 0;
-    float minPotential = FLT_MAX;
-
-    std::vector<float> potentials(width * height);
-
+    traceRecorder::scope trace("calculatePotentialField");
     // Determine the flip state based on the sign of contourThreshold
     bool flipState = contourThreshold < 0;
-    
-    // Compute potential at each pixel
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            float realX = x * downscaleFactor;
-            float realY = y * downscaleFactor;
-            float potential = computePotentialAtPoint(realX, realY);
-            
-            if (flipState) {
-                potential = -potential;
-            }
-            
-            potentials[y * width + x] = potential;
-            maxPotential = std::max(maxPotential, potential);
-            minPotential = std::min(minPotential, potential);
+
+    gridRect dirty;
+    bool fullRedraw = syncPotentialGrid(downscaleFactor, width, height, &dirty) && dirty.empty();
+    if (flipState != displayedFlipState || displayedMaxPotential < 0) {
+        fullRedraw = true;
+    }
+    displayedFlipState = flipState;
+
+    // The brightness is normalized by the maximum. Only a full redraw scans the whole grid for it; a patch keeps the
+    // normalization it is drawn into, so a dragged well repaints just its box (the maximum is refreshed by the
+    // rebuild after mouseReleased). Only a patch that rises above the normalization has to redraw everything.
+    if (fullRedraw) {
+        displayedMaxPotential = maxPotentialIn(gridRect{0, 0, gridWidth, gridHeight}, flipState);
+    }
+    else if (!dirty.empty()) {
+        float patchMax = maxPotentialIn(dirty, flipState);
+        if (patchMax > displayedMaxPotential) {
+            displayedMaxPotential = patchMax;   // everything outside the patch was at most the old maximum
+            fullRedraw = true;
         }
     }
+    float maxPotential = displayedMaxPotential;
 
-    // Normalize and update the potential field image, visualizing it using a logarithmic scale
-    /*
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            float potential = potentials[y * width + x];
-            float logPotential = log(1 + potential - minPotential) / log(1 + maxPotential - minPotential);
-            float normalizedPotential = ofMap(logPotential, 0, 1, 0, 255, true);
-            potentialField.setColor(x, y, ofColor(normalizedPotential));
+    if (fullRedraw) {
+        writePotentialPixels(potentialField, gridRect{0, 0, width, height}, maxPotential, flipState);
+        potentialField.update();
+    }
+    else if (!dirty.empty()) {
+        writePotentialPixels(potentialField, dirty, maxPotential, flipState);
+        uploadPotentialRect(potentialField, dirty);
+    }
+}
+
+void attractorField::invalidatePotentialField() {
+    potentialGridValid = false;
+}
+
+float attractorField::maxPotentialIn(const gridRect& rect, bool flipState) const {
+    float maxPotential = 0;
+    for (int y = rect.y0; y < rect.y1; ++y) {
+        const float* row = &potentialGrid[size_t(y) * gridWidth];
+        for (int x = rect.x0; x < rect.x1; ++x) {
+            maxPotential = std::max(maxPotential, flipState ? -row[x] : row[x]);
         }
     }
-    */
-    
-
-    // Adjust max potential for 20% brightness at contourThreshold
-    float adjustedMaxPotential = contourThreshold * 5;
-    
-    /*
-    // Apply logarithmic scaling to the potential values
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            float potential = potentials[y * width + x];
-            float normalizedPotential = (potential - minPotential) / (adjustedMaxPotential - minPotential);
-
-            // Apply logarithmic scaling
-            float logScaledPotential = log(1 + normalizedPotential * 9) / log(10); // Logarithmic scale base 10
-            float brightness = ofMap(logScaledPotential, 0, 1, 0, 255, true);
-            
-            potentialField.setColor(x, y, ofColor(brightness));
+    return maxPotential;
+}
+
+// Apply linear scaling to the potential values inside rect, writing straight into the 8 bit grayscale buffer
+void attractorField::writePotentialPixels(ofImage& potentialField, const gridRect& rect, float maxPotential, bool flipState) const {
+    ofPixels& pixels = potentialField.getPixels();
+    unsigned char* data = pixels.getData();
+    const size_t channels = pixels.getNumChannels();
+    const int x1 = std::min(rect.x1, int(pixels.getWidth()));
+    const int y1 = std::min(rect.y1, int(pixels.getHeight()));
+    const float scale = maxPotential > 0 ? 255.0f / maxPotential : 0.0f;
+    for (int y = rect.y0; y < y1; ++y) {
+        const float* row = &potentialGrid[size_t(y) * gridWidth];
+        unsigned char* out = data + size_t(y) * pixels.getWidth() * channels;
+        for (int x = rect.x0; x < x1; ++x) {
+            float potential = flipState ? -row[x] : row[x];
+            float brightness = ofClamp(potential * scale, 0.0f, 255.0f);
+            for (size_t c = 0; c < channels; ++c) {
+                out[x * channels + c] = (unsigned char)brightness;
+            }
         }
     }
-    */
-    
-    // Apply linear scaling to the potential values
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            float potential = potentials[y * width + x];
-//            float normalizedPotential = (potential - minPotential) / (adjustedMaxPotential - minPotential);
-            float normalizedPotential = (potential) / (maxPotential);
-            // Linear scaling
-            float brightness = ofMap(normalizedPotential, 0, 1, 0, 255, true);
-            
-            potentialField.setColor(x, y, ofColor(brightness));
+}
+
+// Upload only rect of the pixel buffer to the image's texture
+void attractorField::uploadPotentialRect(ofImage& potentialField, const gridRect& rect) const {
+    if (!potentialField.isUsingTexture() || !potentialField.getTexture().isAllocated()) {
+        potentialField.update();
+        return;
+    }
+    const ofTextureData& texData = potentialField.getTexture().getTextureData();
+    const ofPixels& pixels = potentialField.getPixels();
+    const int x1 = std::min(rect.x1, int(pixels.getWidth()));
+    const int y1 = std::min(rect.y1, int(pixels.getHeight()));
+    if (rect.x0 >= x1 || rect.y0 >= y1) return;
+    const size_t channels = pixels.getNumChannels();
+
+    glBindTexture(texData.textureTarget, texData.textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, int(pixels.getWidth()));
+    glTexSubImage2D(texData.textureTarget, 0, rect.x0, rect.y0, x1 - rect.x0, y1 - rect.y0,
+                    ofGetGLFormatFromInternal(texData.glInternalFormat), GL_UNSIGNED_BYTE,
+                    pixels.getData() + (size_t(rect.y0) * pixels.getWidth() + rect.x0) * channels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(texData.textureTarget, 0);
+}
+
+// Brings potentialGrid up to date with the attractors: only the attractors that moved since the last call are
+// re-splatted, unless the grid itself changed. Returns true if anything changed; dirty receives the patched
+// rectangle, or stays empty after a full rebuild.
+bool attractorField::syncPotentialGrid(float downscaleFactor, int width, int height, gridRect* dirty) {
+    if (!potentialGridValid || width != gridWidth || height != gridHeight || downscaleFactor != gridDownscaleFactor ||
+        rasterized.size() != attractors.size()) {
+        rasterizePotential(downscaleFactor, width, height);
+        return true;
+    }
+    gridRect changed = updateChangedAttractors();
+    if (dirty) *dirty = changed;
+    return !changed.empty();
+}
+
+// Rebuilds potentialGrid from scratch and remembers which attractor parameters it was built from
+void attractorField::rasterizePotential(float downscaleFactor, int width, int height) {
+    traceRecorder::scope trace("potential field rebuild");
+    gridWidth = width;
+    gridHeight = height;
+    gridDownscaleFactor = downscaleFactor;
+    potentialGrid.assign(size_t(width) * height, 0.0f);
+    rowExp.resize(width);
+    columnExp.resize(height);
+
+    rasterized.clear();
+    for (const auto& attractor : attractors) {
+        rasterized.push_back(gaussianOf(attractor));
+        splatGaussian(rasterized.back(), 1.0f);
+    }
+    potentialGridValid = true;
+}
+
+// Subtracts the old and adds the new contribution of every attractor whose parameters changed;
+// returns the grid rectangle that was touched
+attractorField::gridRect attractorField::updateChangedAttractors() {
+    gridRect dirty;
+    for (size_t i = 0; i < attractors.size(); ++i) {
+        gaussianParams current = gaussianOf(attractors[i]);
+        const gaussianParams& previous = rasterized[i];
+        if (current.cx == previous.cx && current.cy == previous.cy &&
+            current.amplitude == previous.amplitude && current.sigma == previous.sigma) {
+            continue;
         }
+        dirty.include(splatGaussian(previous, -1.0f));
+        dirty.include(splatGaussian(current, 1.0f));
+        rasterized[i] = current;
     }
-    
-    potentialField.update();
+    return dirty;
+}
+
+attractorField::gaussianParams attractorField::gaussianOf(const attractor& attractor) {
+    gaussianParams g;
+    g.cx = attractor.getCenter().x;
+    g.cy = attractor.getCenter().y;
+    g.amplitude = attractor.getAmplitude();
+    g.sigma = attractor.getRadius(); // Using radius as sigma
+    return g;
+}
+
+// A Gaussian factors as exp(-dx^2/2s^2) * exp(-dy^2/2s^2), so each attractor needs one exp per column and one per row,
+// and its contribution is the outer product of the two tables. Contributions are cut at 4 sigma (below 0.04% of the
+// amplitude) so that an attractor always covers the same box and can be removed again exactly where it was added.
+attractorField::gridRect attractorField::splatGaussian(const gaussianParams& g, float sign) {
+    const float reach = 4.0f * std::abs(g.sigma);
+    gridRect box;
+    box.x0 = std::max(0, int(std::ceil((g.cx - reach) / gridDownscaleFactor)));
+    box.x1 = std::min(gridWidth, int(std::floor((g.cx + reach) / gridDownscaleFactor)) + 1);
+    box.y0 = std::max(0, int(std::ceil((g.cy - reach) / gridDownscaleFactor)));
+    box.y1 = std::min(gridHeight, int(std::floor((g.cy + reach) / gridDownscaleFactor)) + 1);
+    if (box.empty() || g.sigma == 0.0f) return gridRect();
+
+    for (int x = box.x0; x < box.x1; ++x) {
+        float u = (x * gridDownscaleFactor - g.cx) / g.sigma;
+        rowExp[x] = exp(-0.5f * u * u);
+    }
+    for (int y = box.y0; y < box.y1; ++y) {
+        float u = (y * gridDownscaleFactor - g.cy) / g.sigma;
+        columnExp[y] = sign * g.amplitude * exp(-0.5f * u * u);
+    }
+    for (int y = box.y0; y < box.y1; ++y) {
+        const float weight = columnExp[y];
+        if (weight == 0.0f) continue;  // underflowed, nothing to add on this row
+        float* row = &potentialGrid[size_t(y) * gridWidth];
+        for (int x = box.x0; x < box.x1; ++x) {
+            row[x] += weight * rowExp[x];
+        }
+    }
+    return box;
 }
 
 float attractorField::computePotentialAtPoint(float x, float y) const {
@@ -152,12 +259,8 @@ void attractorField::computeForces(std::vector<ofPoint>& forces, const std::vect
     }
 }
 
-void attractorField::setContourPoints(const std::vector<ofPoint>& points) {
-    contourPoints = points;
-}
-
-const std::vector<ofPoint>& attractorField::getContourPoints() const {
-    return contourPoints;
+const std::vector<ofPolyline>& attractorField::getContourLines() const {
+    return contourLines;
 }
 
 void attractorField::setAttractorCenter(int index, const ofPoint& center) {
@@ -3,6 +3,7 @@
 #include "ofMain.h"
 #include "attractor.h"
 #include "glm/vec3.hpp"
+#include "marchingSquares.h"
 
 class attractorField {
 public:
@@ -11,12 +12,14 @@ public:
     void draw() const;
     void drawContours() const;
     void updateContours(float downscaleFactor, int width, int height, const std::vector<glm::vec3>& equidistantPoints, float contourThreshold);
+    void updateContours(float downscaleFactor, int width, int height, const std::vector<float>& contourThresholds); // one set of lines per threshold
     void calculatePotentialField(ofImage& potentialField, float downscaleFactor, int width, int height, float contourThreshold);
+    void invalidatePotentialField(); // next calculatePotentialField rebuilds the whole grid instead of patching it
+    void setWorkerPool(workerPool* pool) { this->pool = pool; } // updateContours runs on it, e.g. particleEnsemble::getWorkerPool()
     float computePotentialAtPoint(float x, float y) const;
     void computeForces(std::vector<ofPoint>& forces, const std::vector<glm::vec3>& positions, float amplitude, float sigma);
 
-    void setContourPoints(const std::vector<ofPoint>& points);
-    const std::vector<ofPoint>& getContourPoints() const;
+    const std::vector<ofPolyline>& getContourLines() const;
 
     void setAttractorCenter(int index, const ofPoint& center);
     void setAttractorRadius(int index, float radius);
@@ -28,6 +31,46 @@ public:
     attractor& getAttractor(int index);
 
 private:
+    // Parameters an attractor had when it was added to potentialGrid
+    struct gaussianParams {
+        float cx, cy;
+        float amplitude;
+        float sigma;
+    };
+    // Half-open rectangle of grid cells
+    struct gridRect {
+        int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+        bool empty() const { return x0 >= x1 || y0 >= y1; }
+        void include(const gridRect& r) {
+            if (r.empty()) return;
+            if (empty()) { *this = r; return; }
+            x0 = std::min(x0, r.x0); y0 = std::min(y0, r.y0);
+            x1 = std::max(x1, r.x1); y1 = std::max(y1, r.y1);
+        }
+    };
+
+    static gaussianParams gaussianOf(const attractor& attractor);
+    void rasterizePotential(float downscaleFactor, int width, int height); // fills potentialGrid with the summed potential
+    bool syncPotentialGrid(float downscaleFactor, int width, int height, gridRect* dirty = nullptr);
+    gridRect updateChangedAttractors();
+    gridRect splatGaussian(const gaussianParams& g, float sign);
+    float maxPotentialIn(const gridRect& rect, bool flipState) const;
+    void writePotentialPixels(ofImage& potentialField, const gridRect& rect, float maxPotential, bool flipState) const;
+    void uploadPotentialRect(ofImage& potentialField, const gridRect& rect) const;
+
     std::vector<attractor> attractors;
-    std::vector<ofPoint> contourPoints;
+    std::vector<ofPolyline> contourLines;
+    marchingSquares contourExtractor;
+    workerPool* pool = nullptr;
+
+    std::vector<float> potentialGrid;   // unflipped potential at each downscaled pixel, row major
+    std::vector<float> rowExp;          // per-attractor scratch tables for the separable rasterizer
+    std::vector<float> columnExp;
+    std::vector<gaussianParams> rasterized; // what each attractor looked like when it was splatted into potentialGrid
+    int gridWidth = 0;
+    int gridHeight = 0;
+    float gridDownscaleFactor = 0;
+    bool potentialGridValid = false;
+    float displayedMaxPotential = -1;   // normalization currently in the image's pixels, kept while patching
+    bool displayedFlipState = false;
 };
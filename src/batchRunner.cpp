@@ -0,0 +1,299 @@
+#include "batchRunner.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+bool batchRunner::isBatchCommandLine(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--batch") return true;
+    }
+    return false;
+}
+
+int batchRunner::run(int argc, char* argv[]) {
+    if (!parseArguments(argc, argv)) {
+        return 2;
+    }
+    if (sequenceFiles.empty()) {
+        ofLogError("batch") << "No sequence files to run";
+        return 2;
+    }
+
+    ofDirectory::createDirectory(outputDirectory, true, true);
+    particles.setThreadCount(nThreads > 0 ? nThreads : workerPool::hardwareThreads());
+    skeleton.setWorkerPool(&particles.getWorkerPool());
+    particles.forceAccuracy = fastExp ? forceKernelAccuracy::fast : forceKernelAccuracy::exact;
+    if (scheme == "forest-ruth") {
+        particles.setIntegratorMode(integratorMode::forestRuth);
+    }
+    else if (scheme == "pefrl") {
+        particles.setIntegratorMode(integratorMode::pefrl);
+    }
+    else if (scheme == "fixed-point") {
+        particles.setIntegratorMode(integratorMode::fixedPointVerlet);
+    }
+    else if (scheme == "verlet") {
+        particles.setIntegratorMode(classicIntegrator ? integratorMode::velocityVerlet : integratorMode::fusedVelocityVerlet);
+    }
+    else {
+        ofLogError("batch") << "Unknown integrator scheme " << scheme;
+        return 2;
+    }
+
+    int nFailed = 0;
+    for (const auto& filename : sequenceFiles) {
+        if (!runSequence(filename)) {
+            ++nFailed;
+        }
+    }
+    ofLogNotice("batch") << sequenceFiles.size() - nFailed << " of " << sequenceFiles.size() << " sequence files ran";
+    return nFailed == 0 ? 0 : 1;
+}
+
+bool batchRunner::parseArguments(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--batch") {
+            continue;
+        }
+        else if (arg == "--steps" && hasValue) {
+            stepsOverride = ofToInt(argv[++i]);
+        }
+        else if (arg == "--every" && hasValue) {
+            writeInterval = ofToInt(argv[++i]);
+        }
+        else if (arg == "--record" && hasValue) {
+            recordInterval = ofToInt(argv[++i]);
+        }
+        else if (arg == "--precision" && hasValue) {
+            recordPrecision = ofToFloat(argv[++i]);
+        }
+        else if (arg == "--out" && hasValue) {
+            outputDirectory = argv[++i];
+        }
+        else if (arg == "--size" && hasValue) {
+            std::vector<std::string> tokens = ofSplitString(argv[++i], "x");
+            if (tokens.size() == 2) {
+                boxWidth = ofToFloat(tokens[0]);
+                boxHeight = ofToFloat(tokens[1]);
+            }
+        }
+        else if (arg == "--threads" && hasValue) {
+            nThreads = ofToInt(argv[++i]);
+        }
+        else if (arg == "--scheme" && hasValue) {
+            scheme = argv[++i];
+        }
+        else if (arg == "--fast-exp") {
+            fastExp = true;
+        }
+        else if (arg == "--classic") {
+            classicIntegrator = true;
+        }
+        else if (arg.size() > 1 && arg[0] == '-') {
+            ofLogError("batch") << "Unknown or incomplete option " << arg << " (see batchRunner.h for the usage)";
+            return false;
+        }
+        else {
+            collectSequenceFiles(arg);
+        }
+    }
+    if (sequenceFiles.empty()) {
+        collectSequenceFiles("sequence");
+    }
+    return true;
+}
+
+void batchRunner::collectSequenceFiles(const std::string& path) {
+    // paths on the command line are relative to the working directory if they exist there, else to data/
+    std::string resolved = path;
+    if (ofFile::doesFileExist(path, false)) {
+        resolved = ofFilePath::getAbsolutePath(path, false);
+    }
+
+    if (ofDirectory::doesDirectoryExist(resolved)) {
+        ofDirectory dir(resolved);
+        dir.allowExt("xml");
+        dir.listDir();
+        std::vector<std::string> files;
+        for (auto& file : dir) {
+            files.push_back(file.getAbsolutePath());
+        }
+        std::sort(files.begin(), files.end());
+        sequenceFiles.insert(sequenceFiles.end(), files.begin(), files.end());
+    }
+    else {
+        sequenceFiles.push_back(resolved);
+    }
+}
+
+// Mirrors ofApp::loadSettings with the box in place of the window
+bool batchRunner::loadSequence(const std::string& filename) {
+    ofXml settings;
+    if (!settings.load(filename)) {
+        ofLogError("batch") << "Failed to load settings from " << filename;
+        return false;
+    }
+
+    ofXml guiXml = settings.getChild("gui");
+    ofXml guiGroup = guiXml.getChild("group");
+    ofPoint originalWindowSize;
+    std::vector<std::string> tokens = ofSplitString(guiGroup.getChild("Window_Size").getValue(), "x");
+    if (tokens.size() == 2) {
+        originalWindowSize.x = ofToFloat(tokens[0]);
+        originalWindowSize.y = ofToFloat(tokens[1]);
+    }
+    if (originalWindowSize.x <= 0 || originalWindowSize.y <= 0) {
+        ofLogError("batch") << "No window size in " << filename;
+        return false;
+    }
+    sequenceWidth = boxWidth > 0 ? boxWidth : originalWindowSize.x;
+    sequenceHeight = boxHeight > 0 ? boxHeight : originalWindowSize.y;
+    float scaleForCurrentGraphicsWindow = ofMin(sequenceWidth / originalWindowSize.x, sequenceHeight / originalWindowSize.y);
+
+    int numPoints = 2000;
+    if (guiXml.getChild("numPointsInput")) {
+        numPoints = ofToInt(guiXml.getChild("numPointsInput").getValue());
+    }
+    timestep = 0.003;
+    if (guiGroup.getChild("Edit_timestep")) {
+        timestep = guiGroup.getChild("Edit_timestep").getFloatValue();
+    }
+
+    // same clamping as ofApp::onTimeReversalTimestepInputUpdated: the reversal ramp has to fit before the flip
+    timeReversalTimestep = 2000;
+    if (guiGroup.getChild("Time_Reversal_Step")) {
+        timeReversalTimestep = guiGroup.getChild("Time_Reversal_Step").getIntValue();
+    }
+    if (timeReversalTimestep >= 0 && timeReversalTimestep <= schedule.nTimeReversalSteps) {
+        timeReversalTimestep = schedule.nTimeReversalSteps + 1;
+    }
+    else if (timeReversalTimestep < 0 && timeReversalTimestep >= -schedule.nTimeReversalSteps) {
+        timeReversalTimestep = -schedule.nTimeReversalSteps - 1;
+    }
+
+    // skeleton and particles
+    ofXml svgInfoXml = settings.getChild("svgInfoGui");
+    std::string svgFile = svgInfoXml.getChild("svgFile_").getValue();
+    if (svgFile.empty() || !ofFile::doesFileExist(svgFile)) {
+        ofLogError("batch") << "SVG file '" << svgFile << "' of " << filename << " not found";
+        return false;
+    }
+    skeleton.loadSvg(svgFile);
+    skeleton.generateEquidistantPoints(numPoints);
+
+    ofPoint oldSvgCentroid;
+    ofPoint newSvgCentroid;
+    tokens = ofSplitString(svgInfoXml.getChild("svgMidpoint").getValue(), ",");
+    if (tokens.size() == 2) {
+        oldSvgCentroid.x = ofToFloat(tokens[0]);
+        oldSvgCentroid.y = ofToFloat(tokens[1]);
+        newSvgCentroid.x = oldSvgCentroid.x / originalWindowSize.x * sequenceWidth;
+        newSvgCentroid.y = oldSvgCentroid.y / originalWindowSize.y * sequenceHeight;
+        skeleton.translateSvg(newSvgCentroid - skeleton.getSvgCentroid());
+        skeleton.calculateSvgMidpoint();
+    }
+    if (svgInfoXml.getChild("svgScale")) {
+        skeleton.resizeSvg(svgInfoXml.getChild("svgScale").getFloatValue() * scaleForCurrentGraphicsWindow, true);
+    }
+    if (svgInfoXml.getChild("SVG_rot__deg_")) {
+        skeleton.rotateSvg(ofDegToRad(svgInfoXml.getChild("SVG_rot__deg_").getFloatValue()), true);
+    }
+    particles.initialize(skeleton.getEquidistantPoints());
+    particles.setBoundary(sequenceWidth, sequenceHeight);
+    initialPositions = particles.getPositions();
+
+    // attractors, placed relative to the skeleton centroid
+    attractors.clear();
+    for (auto& attractorNode : settings.getChild("attractorGui").getChildren()) {
+        if (attractorNode.getName().find("Attractor_") == std::string::npos) continue;
+        ofPoint center;
+        tokens = ofSplitString(attractorNode.getChild("Center").getValue(), ",");
+        if (tokens.size() == 2) {
+            ofPoint oldAttCentroid(ofToFloat(tokens[0]), ofToFloat(tokens[1]));
+            center = newSvgCentroid + scaleForCurrentGraphicsWindow * (oldAttCentroid - oldSvgCentroid);
+        }
+        float radius = attractorNode.getChild("Radius").getFloatValue() * scaleForCurrentGraphicsWindow;
+        attractor tempAttractor(center, radius);
+        tempAttractor.setAmplitude(attractorNode.getChild("Amplitude").getFloatValue());
+        attractors.push_back(tempAttractor);
+    }
+    return true;
+}
+
+// One file of ofApp::runSequence: reset, time reversal active, the steps there and back
+bool batchRunner::runSequence(const std::string& filename) {
+    if (!loadSequence(filename)) {
+        return false;
+    }
+    std::string sequenceName = ofFilePath::getBaseName(filename);
+
+    int nSteps = stepsOverride > 0 ? stepsOverride : schedule.sequenceLength(timeReversalTimestep);
+    if (nSteps <= 0) {
+        ofLogError("batch") << "Nothing to run in " << filename << " (time reversal step " << timeReversalTimestep << ")";
+        return false;
+    }
+
+    // what runSequence sets up: a reset, time reversal active, the file's timestep and reversal step
+    schedule.reset();
+    schedule.timestep = timestep;
+    schedule.reversalActive = true;
+    schedule.reversalTimestep = timeReversalTimestep;
+
+    if (recordInterval > 0) {
+        std::string trajectoryPath = ofFilePath::join(outputDirectory, sequenceName + "." + trajectoryRecorder::extension());
+        if (!recorder.start(ofToDataPath(trajectoryPath), particles.getPositions().size(), recordPrecision, recordInterval)) {
+            ofLogError("batch") << "Unable to open file for writing: " << trajectoryPath;
+            return false;
+        }
+        recorder.addStep(0, particles.getPositions());     // the start, so playback begins where the run did
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int step = 1; step <= nSteps; ++step) {
+        float dt = schedule.nextTimestep();
+        particles.vv_propagatePositionsVelocities(attractors, dt);
+        schedule.stepTaken();
+        recorder.addStep(schedule.elapsedTimesteps, particles.getPositions());
+
+        if (writeInterval > 0 && step % writeInterval == 0 && step != nSteps) {
+            writeState(sequenceName, step);
+        }
+    }
+    recorder.stop();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    writeState(sequenceName, nSteps);
+
+    // a full sequence ends where it started, so the largest distance to the start position measures reversibility
+    const particleStreams& positions = particles.getPositions();
+    float maxDeviation = 0;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        float dx = positions.x[i] - initialPositions.x[i];
+        float dy = positions.y[i] - initialPositions.y[i];
+        maxDeviation = std::max(maxDeviation, std::sqrt(dx * dx + dy * dy));
+    }
+
+    ofLogNotice("batch") << sequenceName << ": " << positions.size() << " particles, " << attractors.size()
+                         << " attractors, " << nSteps << " steps in " << seconds << " s ("
+                         << (seconds > 0 ? nSteps / seconds : 0) << " steps/s), ended at step " << schedule.elapsedTimesteps
+                         << ", max distance from start " << maxDeviation;
+    return true;
+}
+
+// One line per particle: x,y,vx,vy
+void batchRunner::writeState(const std::string& sequenceName, int step) const {
+    std::string filename = ofFilePath::join(outputDirectory, sequenceName + "_" + ofToString(step, 6, '0') + ".csv");
+    std::ofstream file(ofToDataPath(filename));
+    if (!file.is_open()) {
+        ofLogError("batch") << "Unable to open file for writing: " << filename;
+        return;
+    }
+    const particleStreams& positions = particles.getPositions();
+    const particleStreams& v = particles.v;
+    file << std::setprecision(9);
+    file << "x,y,vx,vy\n";
+    for (size_t i = 0; i < positions.size(); ++i) {
+        file << positions.x[i] << "," << positions.y[i] << "," << v.x[i] << "," << v.y[i] << "\n";
+    }
+}
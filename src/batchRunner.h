@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ofMain.h"
+#include "attractor.h"
+#include "particleEnsemble.h"
+#include "svgSkeleton.h"
+#include "timeReversalSchedule.h"
+#include "trajectoryRecorder.h"
+
+// Headless runner for sequence files, started as
+//
+//     dyantra --batch [options] [settings.xml | directory]...
+//
+// Each settings file is loaded the way ofApp::loadSettings does it and played like one step of ofApp::runSequence
+// (forward to the time reversal step, reverse, back to the start), with no window and no frame rate cap.
+// Directories are expanded to their .xml files in alphabetical order; with no file the "sequence" folder is used.
+//
+//     --steps N       steps per file (default: the full sequence, 2 * (reversal step + reversal ramp + 1))
+//     --every N       also write the state every N steps (default: final state only)
+//     --record N      record the positions every N steps to <out>/<file>.dytraj (see trajectoryRecorder.h)
+//     --precision P   pixels per quantization step of the recording (default 0.01)
+//     --out DIR       where the states go (default: data/batch)
+//     --size WxH      box the particles bounce in (default: the window size stored in the file)
+//     --threads N     integrator threads (default: all hardware threads)
+//     --fast-exp      polynomial exp in the force kernel
+//     --classic       velocityVerlet instead of the fused integrator
+//     --scheme S      verlet (default), forest-ruth or pefrl (4th order, for larger timesteps),
+//                     fixed-point (bit-exact reversal: a full sequence ends exactly where it started)
+class batchRunner {
+public:
+    static bool isBatchCommandLine(int argc, char* argv[]);
+
+    int run(int argc, char* argv[]);   // returns the process exit code
+
+private:
+    bool parseArguments(int argc, char* argv[]);
+    void collectSequenceFiles(const std::string& path);
+    bool loadSequence(const std::string& filename);
+    bool runSequence(const std::string& filename);
+    void writeState(const std::string& sequenceName, int step) const;
+
+    // command line
+    std::vector<std::string> sequenceFiles;
+    int stepsOverride = 0;
+    int writeInterval = 0;
+    int recordInterval = 0;
+    float recordPrecision = 0.01f;
+    std::string outputDirectory = "batch";
+    float boxWidth = 0;
+    float boxHeight = 0;
+    int nThreads = 0;
+    bool fastExp = false;
+    bool classicIntegrator = false;
+    std::string scheme = "verlet";
+
+    // the loaded sequence
+    svgSkeleton skeleton;
+    particleEnsemble particles;
+    std::vector<attractor> attractors;
+    particleStreams initialPositions;
+    float sequenceWidth = 0;
+    float sequenceHeight = 0;
+    float timestep = 0.003;
+    int timeReversalTimestep = 2000;
+    timeReversalSchedule schedule;
+    trajectoryRecorder recorder;
+};
@@ -0,0 +1,414 @@
+#include "benchmarkRunner.h"
+#include "attractorField.h"
+#include "particleEnsemble.h"
+#include "svgSkeleton.h"
+#include <chrono>
+#include <iomanip>
+#include <random>
+
+namespace {
+    const float benchmarkTimestep = 0.003f;
+    const float contourThreshold = 10000.0f;   // ofApp's default slider value
+    const float downscaleFactor = 3.0f;        // ofApp's default downscale
+
+    std::string windowName(const glm::ivec2& window) {
+        return ofToString(window.x) + "x" + ofToString(window.y);
+    }
+}
+
+bool benchmarkRunner::isBenchmarkCommandLine(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--bench") return true;
+    }
+    return false;
+}
+
+int benchmarkRunner::run(int argc, char* argv[]) {
+    if (!parseArguments(argc, argv)) {
+        return 2;
+    }
+    if (quick) {
+        particleCounts = {1000, 100000};
+        attractorCounts = {3, 64};
+        windowSizes = {{1024, 768}};
+        minSeconds = 0.1;
+    }
+    else {
+        particleCounts = {1000, 10000, 100000, 1000000};
+        attractorCounts = {3, 16, 64};
+        windowSizes = {{1024, 768}, {1920, 1080}, {3840, 2160}};
+    }
+
+    pool.setThreadCount(nThreads);
+
+    // time the parsing and resampling themselves, not skeletonCache hits
+    skeletonCache::shared().setBudget(0);
+
+    // writeSvg and loadSvg log every call
+    ofLogLevel logLevel = ofGetLogLevel();
+    ofSetLogLevel(OF_LOG_WARNING);
+
+    benchIntegrator();
+    benchPotentialAtPoint();
+    benchPotentialField();
+    benchContours();
+    benchEquidistantPoints();
+    benchLoadSvg();
+    benchWriteSvg();
+
+    ofSetLogLevel(logLevel);
+
+    if (!writeResults()) {
+        return 2;
+    }
+    return baselineFile.empty() ? 0 : compareWithBaseline();
+}
+
+bool benchmarkRunner::parseArguments(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--bench") {
+            continue;
+        }
+        else if (arg == "--out" && hasValue) {
+            outputFile = argv[++i];
+        }
+        else if (arg == "--compare" && hasValue) {
+            baselineFile = argv[++i];
+        }
+        else if (arg == "--threshold" && hasValue) {
+            thresholdPercent = ofToDouble(argv[++i]);
+        }
+        else if (arg == "--filter" && hasValue) {
+            filter = argv[++i];
+        }
+        else if (arg == "--threads" && hasValue) {
+            nThreads = ofToInt(argv[++i]);
+        }
+        else if (arg == "--quick") {
+            quick = true;
+        }
+        else {
+            ofLogError("bench") << "Unknown or incomplete option " << arg << " (see benchmarkRunner.h for the usage)";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool benchmarkRunner::selected(const std::string& caseId) const {
+    return filter.empty() || caseId.find(filter) != std::string::npos;
+}
+
+// Runs body once to warm up, then repeatedly until minSeconds have passed (at least 3 times)
+void benchmarkRunner::measure(const std::string& name, const std::string& caseId, const ofJson& parameters,
+                              double itemsPerCall, const std::function<void()>& body) {
+    body();
+
+    std::vector<double> times;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while ((elapsed < minSeconds || times.size() < 3) && times.size() < 100000) {
+        auto t0 = std::chrono::steady_clock::now();
+        body();
+        auto t1 = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+        elapsed = std::chrono::duration<double>(t1 - start).count();
+    }
+    std::sort(times.begin(), times.end());
+
+    benchmarkResult result;
+    result.caseId = caseId;
+    result.name = name;
+    result.parameters = parameters;
+    result.itemsPerCall = itemsPerCall;
+    result.iterations = int(times.size());
+    result.medianNs = times[times.size() / 2];
+    result.minNs = times.front();
+    results.push_back(result);
+
+    std::cout << std::left << std::setw(80) << caseId << std::right << std::fixed << std::setprecision(1)
+              << std::setw(14) << result.medianNs * 1e-3 << " us" << std::defaultfloat << std::setprecision(4)
+              << std::setw(12) << itemsPerCall / (result.medianNs * 1e-9) << " items/s" << std::endl;
+}
+
+// Deterministic scenes, so two runs time the same work
+std::vector<attractor> benchmarkRunner::makeAttractors(int count, float width, float height) const {
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(0.1f, 0.9f);
+    std::vector<attractor> attractors;
+    float radius = std::min(width, height) / 8;
+    for (int i = 0; i < count; ++i) {
+        float x = unit(random) * width;
+        float y = unit(random) * height;
+        attractors.emplace_back(ofPoint(x, y), radius);
+    }
+    return attractors;
+}
+
+// First entry is the midpoint, as in svgSkeleton::getEquidistantPoints
+std::vector<glm::vec3> benchmarkRunner::makeParticles(int count, float width, float height) const {
+    std::mt19937 random(5678);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<glm::vec3> points(1, glm::vec3(width / 2, height / 2, 0));
+    for (int i = 0; i < count; ++i) {
+        points.emplace_back(unit(random) * width, unit(random) * height, 0);
+    }
+    return points;
+}
+
+void benchmarkRunner::benchIntegrator() {
+    const std::string name = "vv_propagatePositionsVelocities";
+    particleEnsemble ensemble;
+    ensemble.setThreadCount(nThreads > 0 ? nThreads : workerPool::hardwareThreads());
+    for (const auto& window : windowSizes) {
+        for (int nAttractors : attractorCounts) {
+            std::vector<attractor> attractors = makeAttractors(nAttractors, window.x, window.y);
+            for (int nParticles : particleCounts) {
+                std::string caseId = name + "/particles=" + ofToString(nParticles) + "/attractors=" + ofToString(nAttractors) +
+                                     "/window=" + windowName(window);
+                if (!selected(caseId)) continue;
+                ensemble.initialize(makeParticles(nParticles, window.x, window.y));
+                ensemble.setBoundary(window.x, window.y);
+                ofJson parameters;
+                parameters["particles"] = nParticles;
+                parameters["attractors"] = nAttractors;
+                parameters["window"] = windowName(window);
+                parameters["threads"] = ensemble.getThreadCount();
+                measure(name, caseId, parameters, nParticles, [&]() {
+                    ensemble.vv_propagatePositionsVelocities(attractors, benchmarkTimestep);
+                });
+            }
+        }
+    }
+}
+
+void benchmarkRunner::benchPotentialAtPoint() {
+    const std::string name = "computePotentialAtPoint";
+    const int samplesPerSide = 64;
+    const glm::ivec2& window = windowSizes.front();   // the cost does not depend on where the samples are
+    for (int nAttractors : attractorCounts) {
+        std::string caseId = name + "/attractors=" + ofToString(nAttractors);
+        if (!selected(caseId)) continue;
+        attractorField field;
+        for (const auto& a : makeAttractors(nAttractors, window.x, window.y)) {
+            field.addAttractor(a);
+        }
+        volatile float sink = 0;
+        ofJson parameters;
+        parameters["attractors"] = nAttractors;
+        parameters["points"] = samplesPerSide * samplesPerSide;
+        measure(name, caseId, parameters, samplesPerSide * samplesPerSide, [&]() {
+            float sum = 0;
+            for (int j = 0; j < samplesPerSide; ++j) {
+                for (int i = 0; i < samplesPerSide; ++i) {
+                    sum += field.computePotentialAtPoint(i * window.x / float(samplesPerSide), j * window.y / float(samplesPerSide));
+                }
+            }
+            sink = sum;
+        });
+    }
+}
+
+// Full rebuild of the grid and the grayscale pixels, as after a load or a mouse release; no texture upload
+void benchmarkRunner::benchPotentialField() {
+    const std::string name = "calculatePotentialField";
+    for (const auto& window : windowSizes) {
+        int width = window.x / downscaleFactor;
+        int height = window.y / downscaleFactor;
+        for (int nAttractors : attractorCounts) {
+            std::string caseId = name + "/attractors=" + ofToString(nAttractors) + "/window=" + windowName(window);
+            if (!selected(caseId)) continue;
+            attractorField field;
+            for (const auto& a : makeAttractors(nAttractors, window.x, window.y)) {
+                field.addAttractor(a);
+            }
+            ofImage potentialField;
+            potentialField.setUseTexture(false);
+            potentialField.allocate(width, height, OF_IMAGE_GRAYSCALE);
+            ofJson parameters;
+            parameters["attractors"] = nAttractors;
+            parameters["window"] = windowName(window);
+            parameters["downscale"] = downscaleFactor;
+            measure(name, caseId, parameters, double(width) * height, [&]() {
+                field.invalidatePotentialField();
+                field.calculatePotentialField(potentialField, downscaleFactor, width, height, contourThreshold);
+            });
+        }
+    }
+}
+
+// Contour extraction on an up-to-date grid
+void benchmarkRunner::benchContours() {
+    const std::string name = "updateContours";
+    for (const auto& window : windowSizes) {
+        int width = window.x / downscaleFactor;
+        int height = window.y / downscaleFactor;
+        for (int nAttractors : attractorCounts) {
+            std::string caseId = name + "/attractors=" + ofToString(nAttractors) + "/window=" + windowName(window);
+            if (!selected(caseId)) continue;
+            attractorField field;
+            field.setWorkerPool(&pool);
+            for (const auto& a : makeAttractors(nAttractors, window.x, window.y)) {
+                field.addAttractor(a);
+            }
+            ofJson parameters;
+            parameters["attractors"] = nAttractors;
+            parameters["window"] = windowName(window);
+            parameters["downscale"] = downscaleFactor;
+            measure(name, caseId, parameters, double(width) * height, [&]() {
+                field.updateContours(downscaleFactor, width, height, std::vector<float>{contourThreshold});
+            });
+        }
+    }
+}
+
+void benchmarkRunner::benchEquidistantPoints() {
+    const std::string name = "generateEquidistantPoints";
+    svgSkeleton skeleton;
+    skeleton.setWorkerPool(&pool);
+    bool loaded = false;
+    for (int nPoints : particleCounts) {
+        std::string caseId = name + "/points=" + ofToString(nPoints) + "/svg=" + skeletonFile;
+        if (!selected(caseId)) continue;
+        if (!loaded) {
+            if (!ofFile::doesFileExist(skeletonFile)) {
+                ofLogError("bench") << skeletonFile << " not found, skipping " << name;
+                return;
+            }
+            skeleton.loadSvg(skeletonFile);
+            loaded = true;
+        }
+        ofJson parameters;
+        parameters["points"] = nPoints;
+        parameters["svg"] = skeletonFile;
+        measure(name, caseId, parameters, nPoints, [&]() {
+            skeleton.generateEquidistantPoints(nPoints);
+        });
+    }
+}
+
+// Every SVG shipped in bin/data
+void benchmarkRunner::benchLoadSvg() {
+    const std::string name = "loadSvg";
+    ofDirectory dir(ofToDataPath(""));
+    dir.allowExt("svg");
+    dir.listDir();
+    std::vector<std::string> files;
+    for (auto& file : dir) {
+        files.push_back(file.getFileName());
+    }
+    std::sort(files.begin(), files.end());
+
+    for (const auto& file : files) {
+        std::string caseId = name + "/svg=" + file;
+        if (!selected(caseId)) continue;
+        svgSkeleton skeleton;
+        ofJson parameters;
+        parameters["svg"] = file;
+        measure(name, caseId, parameters, 1, [&]() {
+            skeleton.loadSvg(file);
+        });
+    }
+}
+
+void benchmarkRunner::benchWriteSvg() {
+    const std::string name = "writeSvg";
+    const std::string scratchFile = "benchmark_writeSvg.svg";
+    if (!ofFile::doesFileExist(skeletonFile)) {
+        ofLogError("bench") << skeletonFile << " not found, skipping " << name;
+        return;
+    }
+    svgSkeleton skeleton;
+    particleEnsemble ensemble;
+    bool loaded = false;
+    for (int nPoints : particleCounts) {
+        if (nPoints > 100000) continue;   // tens of MB per call beyond this, mostly timing the disk
+        std::string caseId = name + "/points=" + ofToString(nPoints) + "/svg=" + skeletonFile;
+        if (!selected(caseId)) continue;
+        if (!loaded) {
+            skeleton.loadSvg(skeletonFile);
+            loaded = true;
+        }
+        skeleton.generateEquidistantPoints(nPoints);
+        ensemble.initialize(skeleton.getEquidistantPoints());
+        ofJson parameters;
+        parameters["points"] = nPoints;
+        parameters["svg"] = skeletonFile;
+        measure(name, caseId, parameters, nPoints, [&]() {
+            skeleton.writeSvg(ensemble.getPositions(), scratchFile);
+        });
+    }
+    ofFile::removeFile(scratchFile);
+}
+
+bool benchmarkRunner::writeResults() const {
+    ofJson root;
+    root["forceKernel"] = forceKernelIsaName(getForceKernelIsa());
+    root["hardwareThreads"] = workerPool::hardwareThreads();
+    root["quick"] = quick;
+    root["minSeconds"] = minSeconds;
+    ofJson list = ofJson::array();
+    for (const auto& result : results) {
+        ofJson entry;
+        entry["case"] = result.caseId;
+        entry["name"] = result.name;
+        entry["parameters"] = result.parameters;
+        entry["itemsPerCall"] = result.itemsPerCall;
+        entry["iterations"] = result.iterations;
+        entry["medianNs"] = result.medianNs;
+        entry["minNs"] = result.minNs;
+        entry["itemsPerSecond"] = result.itemsPerCall / (result.medianNs * 1e-9);
+        list.push_back(entry);
+    }
+    root["results"] = list;
+
+    if (!ofSavePrettyJson(outputFile, root)) {
+        ofLogError("bench") << "Unable to write " << outputFile;
+        return false;
+    }
+    ofLogNotice("bench") << results.size() << " results written to " << outputFile;
+    return true;
+}
+
+// Returns 1 if any case is slower than the baseline by more than the threshold
+int benchmarkRunner::compareWithBaseline() const {
+    ofJson baseline = ofLoadJson(baselineFile);
+    if (!baseline.is_object() || !baseline.count("results")) {
+        ofLogError("bench") << "No results in baseline " << baselineFile;
+        return 2;
+    }
+    std::map<std::string, double> baselineNs;
+    for (const auto& entry : baseline["results"]) {
+        baselineNs[entry.value("case", "")] = entry.value("medianNs", 0.0);
+    }
+
+    int nSlower = 0;
+    int nFaster = 0;
+    std::cout << std::endl << "compared with " << baselineFile << " (threshold " << thresholdPercent << "%)" << std::endl;
+    for (const auto& result : results) {
+        auto it = baselineNs.find(result.caseId);
+        std::cout << std::left << std::setw(80) << result.caseId << std::right;
+        if (it == baselineNs.end() || it->second <= 0) {
+            std::cout << "   not in baseline" << std::endl;
+            continue;
+        }
+        double change = 100.0 * (result.medianNs / it->second - 1.0);
+        const char* verdict = "";
+        if (change > thresholdPercent) {
+            verdict = "  SLOWER";
+            ++nSlower;
+        }
+        else if (change < -thresholdPercent) {
+            verdict = "  faster";
+            ++nFaster;
+        }
+        std::cout << std::fixed << std::setprecision(1) << std::setw(14) << it->second * 1e-3 << " -> "
+                  << std::setw(12) << result.medianNs * 1e-3 << " us" << std::showpos << std::setw(9) << change << "%"
+                  << std::noshowpos << verdict << std::defaultfloat << std::endl;
+    }
+    std::cout << nSlower << " slower, " << nFaster << " faster, " << results.size() - nSlower - nFaster
+              << " within the threshold" << std::endl;
+    return nSlower > 0 ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ofMain.h"
+#include "attractor.h"
+#include "workerPool.h"
+
+// Micro-benchmarks for the simulation and preprocessing hot paths, started as
+//
+//     dyantra --bench [options]
+//
+// Each case is timed until it has run for a minimum wall time, and the median time per call is reported together
+// with a throughput (particles, points or pixels per second). Results go to a JSON file; --compare matches them by
+// case id against an earlier file and exits with 1 if any case got slower than the threshold.
+// Relative file names are taken from data/, like everything else the app reads and writes.
+//
+//     --out FILE          results file (default: benchmark.json)
+//     --compare FILE      baseline to compare against
+//     --threshold PCT     change that counts as slower or faster (default 5)
+//     --filter TEXT       only run cases whose id contains TEXT
+//     --quick             fewer sizes and shorter timing, for a smoke test
+//     --threads N         integrator threads (default: all hardware threads)
+class benchmarkRunner {
+public:
+    static bool isBenchmarkCommandLine(int argc, char* argv[]);
+
+    int run(int argc, char* argv[]);   // returns the process exit code
+
+private:
+    struct benchmarkResult {
+        std::string caseId;     // name plus parameters, the key --compare matches on
+        std::string name;
+        ofJson parameters;
+        double itemsPerCall;
+        int iterations;
+        double medianNs;
+        double minNs;
+    };
+
+    bool parseArguments(int argc, char* argv[]);
+    bool selected(const std::string& caseId) const;
+    void measure(const std::string& name, const std::string& caseId, const ofJson& parameters, double itemsPerCall,
+                 const std::function<void()>& body);
+
+    void benchIntegrator();
+    void benchPotentialAtPoint();
+    void benchPotentialField();
+    void benchContours();
+    void benchEquidistantPoints();
+    void benchLoadSvg();
+    void benchWriteSvg();
+
+    std::vector<attractor> makeAttractors(int count, float width, float height) const;
+    std::vector<glm::vec3> makeParticles(int count, float width, float height) const;
+    bool writeResults() const;
+    int compareWithBaseline() const;
+
+    // command line
+    std::string outputFile = "benchmark.json";
+    std::string baselineFile;
+    double thresholdPercent = 5;
+    std::string filter;
+    bool quick = false;
+    int nThreads = 0;
+
+    // sweep
+    std::vector<int> particleCounts;
+    std::vector<int> attractorCounts;
+    std::vector<glm::ivec2> windowSizes;
+    double minSeconds = 0.3;
+    std::string skeletonFile = "taraYantra.svg";
+    workerPool pool{1};     // --threads, for the cases that do not go through a particleEnsemble
+
+    std::vector<benchmarkResult> results;
+};
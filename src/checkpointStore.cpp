@@ -0,0 +1,106 @@
+#include "checkpointStore.h"
+#include <algorithm>
+
+void checkpointStore::setBudget(size_t bytes) {
+    if (bytes == budget) return;
+    budget = bytes;
+    if (budget == 0) {
+        clear();
+        return;
+    }
+    enforceBudget();
+}
+
+void checkpointStore::clear() {
+    entries.clear();
+    spacing = 1;
+}
+
+void checkpointStore::restart(long long step, checkpoint state) {
+    clear();
+    origin = step;
+    if (budget == 0) return;
+    add(step, std::move(state));
+}
+
+bool checkpointStore::wantsCheckpoint(long long step) const {
+    return budget > 0 && (step - origin) % spacing == 0 && entries.count(step) == 0;
+}
+
+void checkpointStore::add(long long step, checkpoint state) {
+    checkpointBytes = state.particles.bytes() + sizeof(checkpoint);
+    entries[step] = entry{std::move(state), false};
+    enforceBudget();
+}
+
+void checkpointStore::addReplay(long long step, checkpoint state) {
+    if (budget == 0 || entries.count(step)) return;
+    checkpointBytes = state.particles.bytes() + sizeof(checkpoint);
+    entries[step] = entry{std::move(state), true};
+    enforceBudget();
+}
+
+void checkpointStore::truncate(long long step) {
+    entries.erase(entries.upper_bound(step), entries.end());
+}
+
+void checkpointStore::dropReplaysAfter(long long step) {
+    for (auto it = entries.upper_bound(step); it != entries.end();) {
+        if (it->second.replay) it = entries.erase(it);
+        else ++it;
+    }
+}
+
+const checkpointStore::checkpoint* checkpointStore::find(long long step, long long& checkpointStep) const {
+    auto it = entries.upper_bound(step);
+    if (it == entries.begin()) return nullptr;
+    --it;
+    checkpointStep = it->first;
+    return &it->second.state;
+}
+
+// to - g/2, to - g/4, ... to - 1 for a gap of g = to - from: each halves what is left to replay from the last one
+bool checkpointStore::isBisectionStep(long long from, long long to, long long step) {
+    long long gap = to - from;
+    for (long long half = gap / 2; half > 0; half /= 2) {
+        if (step == to - half) return true;
+    }
+    return false;
+}
+
+size_t checkpointStore::capacity() const {
+    if (checkpointBytes == 0) return entries.size();
+    return std::max<size_t>(budget / checkpointBytes, 1);
+}
+
+void checkpointStore::enforceBudget() {
+    size_t total = capacity();
+    size_t replayCapacity = total / 4;  // the rest keeps the regular spacing
+    size_t regularCapacity = std::max<size_t>(total - replayCapacity, 1);
+
+    size_t nReplay = 0;
+    for (const auto& it : entries) {
+        if (it.second.replay) ++nReplay;
+    }
+    // replay checkpoints: the oldest go first, the scrub works its way back from the newest
+    for (auto it = entries.begin(); it != entries.end() && nReplay > replayCapacity;) {
+        if (it->second.replay) {
+            it = entries.erase(it);
+            --nReplay;
+        }
+        else ++it;
+    }
+
+    // regular checkpoints: double the spacing and drop the ones off the new grid; the start always stays
+    size_t nRegular = entries.size() - nReplay;
+    while (nRegular > regularCapacity && nRegular > 1) {
+        spacing *= 2;
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (!it->second.replay && it->first != origin && (it->first - origin) % spacing != 0) {
+                it = entries.erase(it);
+                --nRegular;
+            }
+            else ++it;
+        }
+    }
+}
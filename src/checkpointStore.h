@@ -0,0 +1,60 @@
+#pragma once
+
+#include <map>
+#include "particleEnsemble.h"
+#include "timeReversalSchedule.h"
+
+// Checkpoints along the timeline of a run (steps taken since it started), so any earlier step can be shown again
+// without a reset and a full re-integration.
+//
+// While the simulation runs, a checkpoint is kept every 'spacing' steps. When they outgrow the memory budget the
+// spacing doubles and every other one goes, so a run of T steps keeps between s/2 and s of the s checkpoints that
+// fit, and a seek to any step recomputes at most 2T/s steps. No fixed budget does better for a random seek: with s
+// checkpoints over T steps some gap is at least T/s long, so O(log T) per seek would need memory growing as T/log T.
+// The logarithmic bound holds when stepping backwards instead. Replaying a gap leaves extra checkpoints at its
+// bisection points, as in Griewank's binomial checkpointing. After the first seek into a gap of g steps (at most 2T/s
+// recomputed), every further step back costs O(log g) amortized, not O(g).
+class checkpointStore {
+public:
+    struct checkpoint {
+        particleState particles;
+        timeReversalSchedule schedule;
+    };
+
+    void setBudget(size_t bytes);   // 0 = no checkpoints
+    size_t getBudget() const { return budget; }
+
+    void restart(long long step, checkpoint state);     // drops everything, the timeline now starts at step
+    void clear();
+    bool isEmpty() const { return entries.empty(); }
+
+    // Recording: after every step, add a checkpoint when asked for one
+    bool wantsCheckpoint(long long step) const;
+    void add(long long step, checkpoint state);
+    void truncate(long long step);  // forgets everything after step, when the run carries on from there
+
+    // Seeking: the latest checkpoint at or before step, nullptr if there is none
+    const checkpoint* find(long long step, long long& checkpointStep) const;
+    // While replaying from 'from' to 'to': the steps at which to leave a replay checkpoint
+    static bool isBisectionStep(long long from, long long to, long long step);
+    void addReplay(long long step, checkpoint state);
+    void dropReplaysAfter(long long step);  // they are in the way once the scrub has gone back past them
+
+    long long getOrigin() const { return origin; }
+    size_t size() const { return entries.size(); }
+    size_t bytesUsed() const { return entries.size() * checkpointBytes; }
+
+private:
+    struct entry {
+        checkpoint state;
+        bool replay;    // left by a replay, dropped before the regular ones
+    };
+    void enforceBudget();
+    size_t capacity() const;
+
+    std::map<long long, entry> entries;
+    size_t budget = 0;
+    size_t checkpointBytes = 0;     // size of the last checkpoint added
+    long long origin = 0;
+    long long spacing = 1;
+};
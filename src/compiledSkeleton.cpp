@@ -0,0 +1,166 @@
+#include "compiledSkeleton.h"
+#include "sectionFile.h"
+#include "svgSkeleton.h"
+
+namespace {
+    const char skeletonMagic[8] = {'D', 'Y', 'S', 'K', 'E', 'L', 0, 0};
+    const uint32_t skeletonVersion = 1;
+
+    struct fileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        int32_t requestedPoints;
+        uint32_t nPoints;
+        uint32_t nOutlines;
+        float width;
+        float height;
+        float midpoint[3];
+        uint32_t nSections;
+        uint32_t reserved;
+    };
+
+    enum sectionId : uint32_t {
+        pointSection = 1,       // x, y, z per point
+        pointPathSection,       // uint32 per point into pathLabelSection
+        pathLabelSection,       // NUL-terminated strings
+        outlineSection,         // per outline: number of vertices, number of vertex indices
+        vertexSection,          // x, y, z per vertex, all outlines in order
+        vertexIndexSection,     // int32 per vertex index, all outlines in order
+        svgFileSection
+    };
+}
+
+bool compiledSkeleton::save(const std::string& path) const {
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "skeleton points are written as packed float triples");
+    std::vector<sectionFile::section> sections;
+    sections.push_back({pointSection, points.points.data(), points.points.size() * sizeof(glm::vec3)});
+
+    std::vector<uint32_t> pathIndices;
+    std::string pathLabels;
+    sectionFile::encodeStrings(points.pathIDs, pathIndices, pathLabels);
+    sections.push_back({pointPathSection, pathIndices.data(), pathIndices.size() * sizeof(uint32_t)});
+    sections.push_back({pathLabelSection, pathLabels.data(), pathLabels.size()});
+
+    std::vector<uint32_t> outlineSizes;
+    std::vector<glm::vec3> vertices;
+    std::vector<int32_t> vertexIndices;
+    for (size_t i = 0; i < points.pathVertices.size(); ++i) {
+        const auto& outlineVertices = points.pathVertices[i];
+        const auto& outlineIndices = points.pathVerticesIndices[i];
+        outlineSizes.push_back(uint32_t(outlineVertices.size()));
+        outlineSizes.push_back(uint32_t(outlineIndices.size()));
+        vertices.insert(vertices.end(), outlineVertices.begin(), outlineVertices.end());
+        vertexIndices.insert(vertexIndices.end(), outlineIndices.begin(), outlineIndices.end());
+    }
+    sections.push_back({outlineSection, outlineSizes.data(), outlineSizes.size() * sizeof(uint32_t)});
+    sections.push_back({vertexSection, vertices.data(), vertices.size() * sizeof(glm::vec3)});
+    sections.push_back({vertexIndexSection, vertexIndices.data(), vertexIndices.size() * sizeof(int32_t)});
+    sections.push_back({svgFileSection, svgFile.data(), svgFile.size()});
+
+    fileHeader header = {};
+    std::memcpy(header.magic, skeletonMagic, sizeof(skeletonMagic));
+    header.version = skeletonVersion;
+    header.byteOrder = sectionFile::byteOrderMark;
+    header.requestedPoints = requestedPoints;
+    header.nPoints = uint32_t(points.points.size());
+    header.nOutlines = uint32_t(points.pathVertices.size());
+    header.width = width;
+    header.height = height;
+    header.midpoint[0] = midpoint.x;
+    header.midpoint[1] = midpoint.y;
+    header.midpoint[2] = midpoint.z;
+    header.nSections = uint32_t(sections.size());
+    return sectionFile::write(path, &header, sizeof(header), sections);
+}
+
+bool compiledSkeleton::load(const std::string& path) {
+    mappedFile file;
+    if (!file.open(path)) {
+        ofLogError("skeleton") << "Unable to open " << path;
+        return false;
+    }
+    sectionFile::reader reader;
+    fileHeader header;
+    if (!reader.readHeader(file, header) || std::memcmp(header.magic, skeletonMagic, sizeof(skeletonMagic)) != 0
+        || header.version != skeletonVersion || header.byteOrder != sectionFile::byteOrderMark
+        || !reader.readTable(header.nSections)) {
+        ofLogError("skeleton") << path << " is not a skeleton this version can read";
+        return false;
+    }
+    size_t nPoints = header.nPoints;
+    if (!reader.readArray(pointSection, nPoints, points.points)) {
+        ofLogError("skeleton") << path << " has no points";
+        return false;
+    }
+    requestedPoints = header.requestedPoints;
+    width = header.width;
+    height = header.height;
+    midpoint = glm::vec3(header.midpoint[0], header.midpoint[1], header.midpoint[2]);
+    svgFile = reader.readString(svgFileSection);
+
+    // path IDs are optional, like in generateEquidistantPoints: an SVG without path IDs has none
+    uint64_t bytes;
+    const unsigned char* p = reader.find(pathLabelSection, bytes);
+    std::vector<std::string> labels = sectionFile::decodeTable(p, bytes);
+    std::vector<uint32_t> pathIndices;
+    reader.readArray(pointPathSection, pathIndices);
+    points.pathIDs.clear();
+    points.pathIDs.reserve(pathIndices.size());
+    for (uint32_t index : pathIndices) {
+        points.pathIDs.push_back(index < labels.size() ? labels[index] : std::string());
+    }
+
+    // the vertex tables, all or nothing
+    std::vector<uint32_t> outlineSizes;
+    std::vector<glm::vec3> vertices;
+    std::vector<int32_t> vertexIndices;
+    reader.readArray(outlineSection, size_t(header.nOutlines) * 2, outlineSizes);
+    reader.readArray(vertexSection, vertices);
+    reader.readArray(vertexIndexSection, vertexIndices);
+    points.pathVertices.clear();
+    points.pathVerticesIndices.clear();
+    size_t vertex = 0, vertexIndex = 0;
+    for (size_t i = 0; i + 1 < outlineSizes.size(); i += 2) {
+        if (outlineSizes[i] > vertices.size() - vertex || outlineSizes[i + 1] > vertexIndices.size() - vertexIndex) {
+            points.pathVertices.clear();
+            points.pathVerticesIndices.clear();
+            break;
+        }
+        points.pathVertices.emplace_back(vertices.begin() + vertex, vertices.begin() + vertex + outlineSizes[i]);
+        points.pathVerticesIndices.emplace_back(vertexIndices.begin() + vertexIndex,
+                                                vertexIndices.begin() + vertexIndex + outlineSizes[i + 1]);
+        vertex += outlineSizes[i];
+        vertexIndex += outlineSizes[i + 1];
+    }
+    return true;
+}
+
+bool compiledSkeleton::isCompileCommandLine(int argc, char* argv[]) {
+    return argc >= 2 && std::string(argv[1]) == "--compile-skeleton";
+}
+
+int compiledSkeleton::compileCommandLine(int argc, char* argv[]) {
+    if (argc < 4 || argc > 5) {
+        ofLogError("skeleton") << "usage: dyantra --compile-skeleton file.svg points [out.dyskel]";
+        return 2;
+    }
+    std::string svgFile = argv[2];
+    int nPoints = ofToInt(argv[3]);
+    std::string outFile = argc == 5 ? argv[4]
+                        : ofFilePath::removeExt(svgFile) + "_" + ofToString(nPoints) + "." + extension();
+    if (nPoints <= 0 || !ofFile::doesFileExist(svgFile)) {
+        ofLogError("skeleton") << "need an existing SVG and a point count above 0";
+        return 2;
+    }
+
+    svgSkeleton skeleton;
+    skeleton.loadSvg(svgFile);
+    skeleton.generateEquidistantPoints(nPoints);
+    if (!skeleton.saveCompiled(outFile)) {
+        ofLogError("skeleton") << "Unable to write " << outFile;
+        return 1;
+    }
+    ofLogNotice("skeleton") << outFile << ": " << skeleton.getEquidistantPoints().size() << " points";
+    return 0;
+}
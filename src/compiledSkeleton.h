@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ofMain.h"
+#include "skeletonCache.h"
+
+// Precompiled skeleton (.dyskel): the points generateEquidistantPoints makes from an SVG for one point count, with
+// their path IDs and the outline vertex tables, so a sequence or the app starts without reading the SVG at all.
+// svgSkeleton::loadSvg takes a .dyskel wherever it takes an SVG (svgFile_ in the settings, snapshots); asked for a
+// different point count it resamples the SVG the file names.
+//
+// Made offline with
+//
+//     dyantra --compile-skeleton file.svg points [out.dyskel]
+//
+// or in the app from the loaded skeleton ('d', or a .dyskel name in the save box). Stored as sections
+// (see sectionFile.h) and read through a memory map.
+struct compiledSkeleton {
+    static const char* extension() { return "dyskel"; }
+    static bool isCompiledSkeleton(const std::string& filename) { return ofFilePath::getFileExt(filename) == extension(); }
+
+    std::string svgFile;            // what it was compiled from, to resample for another point count
+    int requestedPoints = 0;        // numDesiredPoints it was compiled for
+    float width = 0;                // of the SVG, for autoFitToWindow
+    float height = 0;
+    glm::vec3 midpoint;             // untransformed, as calculateSvgMidpoint finds it
+    skeletonCache::resampledPoints points;
+
+    bool save(const std::string& path) const;   // full paths, see ofToDataPath
+    bool load(const std::string& path);
+
+    // dyantra --compile-skeleton: returns the process exit code
+    static bool isCompileCommandLine(int argc, char* argv[]);
+    static int compileCommandLine(int argc, char* argv[]);
+};
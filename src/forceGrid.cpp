@@ -0,0 +1,180 @@
+#include "forceGrid.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const int maxCoverageBins = 64;     // per side, for finding how many wells can overlap at one point
+
+    // Bound on |d2/du2| + |d2/dv2| of u exp(-(u^2 + v^2) / 2), the force of a unit well in sigma units, at distance
+    // rho or more from its centre: 1.96 overall, and (r^3 + 4r) exp(-r^2 / 2) falls off from r = 1.25 on
+    float curvatureBound(float rho) {
+        float r = std::max(rho, 1.25f);
+        return std::min(1.96f, (r * r * r + 4.0f * r) * std::exp(-0.5f * r * r));
+    }
+}
+
+bool forceGrid::update(const std::vector<gaussianWell>& wells, float width, float height, float tolerance) {
+    if (width == builtWidth && height == builtHeight && tolerance == builtTolerance && sameWells(wells, builtWells)) {
+        return false;
+    }
+    builtWells = wells;
+    builtWidth = width;
+    builtHeight = height;
+    builtTolerance = tolerance;
+
+    tolerance = std::min(std::max(tolerance, 1e-4f), 0.5f);   // below that, float rounding in the sums counts too
+
+    // A well's force, coefficient * r exp(-r^2 / 2s^2), peaks at |coefficient| s exp(-1/2) at r = s
+    float peakForce = 0;
+    double tailSum = 0;     // sum of |coefficient| s: what the truncated tails of all wells add up to, per unit of r exp(-r^2/2)
+    float maxReachSigma = 0;
+    for (const auto& well : wells) {
+        float sigma = std::sqrt(-0.5f * well.expDenominator);
+        if (!(sigma > 0)) continue;
+        peakForce = std::max(peakForce, std::abs(well.coefficient) * sigma * std::exp(-0.5f));
+        tailSum += std::abs(well.coefficient) * sigma;
+        maxReachSigma = std::max(maxReachSigma, sigma);
+    }
+
+    // Half the tolerance goes to truncation. Every well is cut off at the same number of sigmas, where its force is
+    // down to |coefficient| s * cutoff exp(-cutoff^2 / 2); wherever a particle is, all the wells cut off there add
+    // at most tailSum times that, however many overlap.
+    float cutoff = 3.0f;
+    if (tailSum > 0) {
+        double allowed = 0.5 * tolerance * peakForce / tailSum;
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            cutoff = float(std::sqrt(2.0 * std::log(std::max(cutoff / allowed, 1.0))));
+        }
+        cutoff = std::max(cutoff, 1.0f);    // past the peak, so the tail only falls off
+    }
+
+    // The other half goes to the bilinear interpolation, off by at most h^2/8 (|f_xx| + |f_yy|) per component,
+    // which for a well is h^2/8 * curvatureBound * |coefficient| / s. Only wells whose splat box reaches a node of
+    // the cell around a point are interpolated there (the others read zeros, already counted as truncation), so the
+    // curvature that matters is the largest sum over wells reaching one spot. It is found on a coarse grid of bins,
+    // with the boxes grown by a bin and the spacing kept below a bin so that every such well is counted.
+    float binSize = std::max(std::max(width, height) / maxCoverageBins, 1.0f);
+    int binColumns = std::max(1, int(std::ceil(width / binSize)));
+    int binRows = std::max(1, int(std::ceil(height / binSize)));
+    std::vector<double> coverage(size_t(binColumns) * binRows, 0.0);
+    for (const auto& well : wells) {
+        float sigma = std::sqrt(-0.5f * well.expDenominator);
+        if (!(sigma > 0)) continue;
+        float reach = cutoff * sigma + binSize;
+        int i0 = std::max(0, int(std::floor((well.cx - reach) / binSize)));
+        int i1 = std::min(binColumns - 1, int(std::floor((well.cx + reach) / binSize)));
+        int j0 = std::max(0, int(std::floor((well.cy - reach) / binSize)));
+        int j1 = std::min(binRows - 1, int(std::floor((well.cy + reach) / binSize)));
+        float scale = std::abs(well.coefficient) / sigma;
+        for (int j = j0; j <= j1; ++j) {
+            float dy = std::max(std::max(j * binSize - well.cy, well.cy - (j + 1) * binSize), 0.0f);
+            for (int i = i0; i <= i1; ++i) {
+                float dx = std::max(std::max(i * binSize - well.cx, well.cx - (i + 1) * binSize), 0.0f);
+                // the cell nodes of a point in this bin are at most one bin further out
+                float rho = std::max(std::sqrt(dx * dx + dy * dy) - binSize, 0.0f) / sigma;
+                coverage[size_t(j) * binColumns + i] += scale * curvatureBound(rho);
+            }
+        }
+    }
+    double maxCurvature = *std::max_element(coverage.begin(), coverage.end());
+
+    spacing = maxCurvature > 0 ? float(std::sqrt(8.0 * 0.5 * tolerance * peakForce / maxCurvature)) : std::max(width, height);
+    spacing = std::max(std::min(spacing, binSize), 0.25f);
+    withinTolerance = tolerance == builtTolerance && spacing > 0.25f;
+    while ((std::ceil(width / spacing) + 2) * (std::ceil(height / spacing) + 2) > maxNodes) {
+        spacing *= 1.25f;
+        withinTolerance = false;
+    }
+    inverseSpacing = 1.0f / spacing;
+    columns = int(std::ceil(width / spacing)) + 2;
+    rows = int(std::ceil(height / spacing)) + 2;
+
+    // What the table can promise, above the tolerance only when withinTolerance is false
+    float truncationError = tailSum > 0 ? float(tailSum * cutoff * std::exp(-0.5 * cutoff * cutoff)) : 0.0f;
+    float interpolationError = float(spacing * spacing / 8.0 * maxCurvature);
+    errorBound = peakForce > 0 ? (truncationError + interpolationError) / peakForce : 0.0f;
+
+    // Not worth building a table nobody will read
+    if (!withinTolerance) {
+        fx.clear();
+        fy.clear();
+        return true;
+    }
+
+    fx.assign(size_t(columns) * rows, 0.0f);
+    fy.assign(size_t(columns) * rows, 0.0f);
+    columnExp.resize(columns);
+    columnExpDx.resize(columns);
+    rowExp.resize(rows);
+    rowExpDy.resize(rows);
+
+    for (const auto& well : wells) {
+        splat(well, cutoff);
+    }
+    return true;
+}
+
+// F(x, y) = -coefficient * exp(-dx^2 / 2s^2) * exp(-dy^2 / 2s^2) * (dx, dy) is an outer product of a column table
+// and a row table for each component
+void forceGrid::splat(const gaussianWell& well, float cutoff) {
+    float sigma = std::sqrt(-0.5f * well.expDenominator);
+    if (!(sigma > 0)) return;
+    float reach = cutoff * sigma;
+    int i0 = std::max(0, int(std::ceil((well.cx - reach) * inverseSpacing)));
+    int i1 = std::min(columns, int(std::floor((well.cx + reach) * inverseSpacing)) + 1);
+    int j0 = std::max(0, int(std::ceil((well.cy - reach) * inverseSpacing)));
+    int j1 = std::min(rows, int(std::floor((well.cy + reach) * inverseSpacing)) + 1);
+    if (i0 >= i1 || j0 >= j1) return;
+
+    for (int i = i0; i < i1; ++i) {
+        float dx = i * spacing - well.cx;
+        columnExp[i] = std::exp(dx * dx / well.expDenominator);
+        columnExpDx[i] = columnExp[i] * dx;
+    }
+    for (int j = j0; j < j1; ++j) {
+        float dy = j * spacing - well.cy;
+        rowExp[j] = -well.coefficient * std::exp(dy * dy / well.expDenominator);
+        rowExpDy[j] = rowExp[j] * dy;
+    }
+    for (int j = j0; j < j1; ++j) {
+        float* rowFx = &fx[size_t(j) * columns];
+        float* rowFy = &fy[size_t(j) * columns];
+        const float wx = rowExp[j];
+        const float wy = rowExpDy[j];
+        for (int i = i0; i < i1; ++i) {
+            rowFx[i] += wx * columnExpDx[i];
+            rowFy[i] += wy * columnExp[i];
+        }
+    }
+}
+
+void forceGrid::sample(const particleStreams& positions, particleStreams& forces, size_t begin, size_t end) const {
+    const float* x = positions.x.data();
+    const float* y = positions.y.data();
+    float* outX = forces.x.data();
+    float* outY = forces.y.data();
+#ifdef DYANTRA_PARTICLE_Z
+    float* outZ = forces.z.data();
+#endif
+    if (fx.empty()) return;
+    const float maxU = float(columns - 1) - 1e-3f;
+    const float maxV = float(rows - 1) - 1e-3f;
+    for (size_t p = begin; p < end; ++p) {
+        float u = std::min(std::max(x[p] * inverseSpacing, 0.0f), maxU);
+        float v = std::min(std::max(y[p] * inverseSpacing, 0.0f), maxV);
+        int i = int(u);
+        int j = int(v);
+        float tu = u - i;
+        float tv = v - j;
+        size_t n = size_t(j) * columns + i;
+        float top = fx[n] + tu * (fx[n + 1] - fx[n]);
+        float bottom = fx[n + columns] + tu * (fx[n + columns + 1] - fx[n + columns]);
+        outX[p] = top + tv * (bottom - top);
+        top = fy[n] + tu * (fy[n + 1] - fy[n]);
+        bottom = fy[n + columns] + tu * (fy[n + columns + 1] - fy[n + columns]);
+        outY[p] = top + tv * (bottom - top);
+#ifdef DYANTRA_PARTICLE_Z
+        outZ[p] = 0.0f;
+#endif
+    }
+}
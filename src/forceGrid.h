@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include "forceKernel.h"
+
+// Grid-based fast Gauss transform for the attractor forces.
+// The summed force field is tabulated on a regular grid over the window, one separable splat per attractor
+// cut off where its tail no longer matters, and particles read it back by bilinear interpolation.
+// Building costs O(M * splat size), sampling O(N), so the step no longer scales with N * M.
+// The force stays a fixed function of position, so time reversal still retraces the trajectory.
+class forceGrid {
+public:
+    // Re-tabulates the field if the wells, the domain or the tolerance changed; returns true if it did.
+    // tolerance bounds the error of each force component inside the domain, relative to the peak force of the
+    // strongest well: the spacing and the truncation radius are derived from it, half for the summed tails of the
+    // cut-off Gaussians and half for the bilinear interpolation of the wells that overlap.
+    bool update(const std::vector<gaussianWell>& wells, float width, float height, float tolerance);
+
+    // Writes the interpolated force into forces[i] for particles i in [begin, end); nothing unless isWithinTolerance
+    void sample(const particleStreams& positions, particleStreams& forces, size_t begin, size_t end) const;
+
+    float getSpacing() const { return spacing; }
+    int getColumns() const { return columns; }
+    int getRows() const { return rows; }
+    float getErrorBound() const { return errorBound; }
+    bool isWithinTolerance() const { return withinTolerance; }  // false if the spacing needed more than maxNodes
+
+private:
+    void splat(const gaussianWell& well, float cutoff);
+
+    static const int maxNodes = 2048 * 2048;   // 32 MB of table at most
+
+    std::vector<float> fx;  // force at each node, row major, node (i, j) sits at (i * spacing, j * spacing)
+    std::vector<float> fy;
+    int columns = 0;
+    int rows = 0;
+    float spacing = 1.0f;
+    float inverseSpacing = 1.0f;
+    float errorBound = 0;
+    bool withinTolerance = false;
+
+    // what the current table was built from
+    std::vector<gaussianWell> builtWells;
+    float builtWidth = -1;
+    float builtHeight = -1;
+    float builtTolerance = -1;
+
+    // separable splat scratch
+    std::vector<float> columnExp, columnExpDx, rowExp, rowExpDy;
+};
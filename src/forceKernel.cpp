@@ -0,0 +1,547 @@
+#include "forceKernel.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// The exact mode promises bit-identical forces on every path, so a*b+c must never be fused into an fma
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#else
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)) && !defined(_M_ARM64EC)
+#define DYANTRA_KERNEL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define DYANTRA_TARGET_AVX2
+#define DYANTRA_TARGET_AVX512
+#else
+#define DYANTRA_TARGET_AVX2 __attribute__((target("avx2")))
+#define DYANTRA_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define DYANTRA_KERNEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Asks for a full unroll of the well loop when its trip count is a template constant
+#if defined(__clang__)
+#define DYANTRA_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+#define DYANTRA_UNROLL _Pragma("GCC unroll 8")
+#else
+#define DYANTRA_UNROLL
+#endif
+
+namespace {
+
+// Wells up to this count get a kernel specialized on the count, larger fields use the runtime loop
+const int maxUnrolledWells = 8;
+
+// Cephes-style expf: exp(x) = 2^n * p(r), with x = n*ln2 + r and |r| <= ln2/2
+const float expUpperBound = 88.3762626647949f;
+const float expLowerBound = -86.0f;   // flushed to 0 a little before expf underflows, so results never go denormal
+const float log2e = 1.44269504088896341f;
+const float expC1 = 0.693359375f;
+const float expC2 = -2.12194440e-4f;
+const float expP0 = 1.9875691500E-4f;
+const float expP1 = 1.3981999507E-3f;
+const float expP2 = 8.3334519073E-3f;
+const float expP3 = 4.1665795894E-2f;
+const float expP4 = 1.6666665459E-1f;
+const float expP5 = 5.0000001201E-1f;
+
+// scalar twin of the vector approximations below, performing the same operations in the same order
+inline float fastExp(float x) {
+    if (x < expLowerBound) return 0.0f;
+    x = std::min(x, expUpperBound);
+    float fx = std::floor(x * log2e + 0.5f);
+    x = x - fx * expC1;
+    x = x - fx * expC2;
+    float z = x * x;
+    float y = expP0;
+    y = y * x + expP1;
+    y = y * x + expP2;
+    y = y * x + expP3;
+    y = y * x + expP4;
+    y = y * x + expP5;
+    y = y * z + x + 1.0f;
+    int32_t bits = (static_cast<int32_t>(fx) + 127) << 23;
+    float pow2n;
+    std::memcpy(&pow2n, &bits, sizeof(float));
+    return y * pow2n;
+}
+
+// Reference loop: one particle at a time, same arithmetic as the original calculateGaussianForce
+void gaussianForcesScalar(const particleStreams& positions, particleStreams& forces, size_t begin, size_t end,
+                          const gaussianWell* wells, size_t nWells, forceKernelAccuracy accuracy) {
+    const float* x = positions.x.data();
+    const float* y = positions.y.data();
+    float* fx = forces.x.data();
+    float* fy = forces.y.data();
+#ifdef DYANTRA_PARTICLE_Z
+    const float* z = positions.z.data();
+    float* fz = forces.z.data();
+#endif
+    for (size_t i = begin; i < end; ++i) {
+        float fxTotal = 0.0f;
+        float fyTotal = 0.0f;
+#ifdef DYANTRA_PARTICLE_Z
+        float fzTotal = 0.0f;
+#endif
+        for (size_t k = 0; k < nWells; ++k) {
+            const gaussianWell& well = wells[k];
+            float dx = x[i] - well.cx;
+            float dy = y[i] - well.cy;
+#ifdef DYANTRA_PARTICLE_Z
+            float dz = z[i] - well.cz;
+            float exp_numerator = dx * dx + dy * dy + dz * dz;
+#else
+            float exp_numerator = dx * dx + dy * dy;
+#endif
+            float arg = exp_numerator / well.expDenominator;
+            float e = (accuracy == forceKernelAccuracy::exact) ? std::exp(arg) : fastExp(arg);
+            float prefactor = -(well.coefficient * e);
+            fxTotal += prefactor * dx;
+            fyTotal += prefactor * dy;
+#ifdef DYANTRA_PARTICLE_Z
+            fzTotal += prefactor * dz;
+#endif
+        }
+        fx[i] = fxTotal;
+        fy[i] = fyTotal;
+#ifdef DYANTRA_PARTICLE_Z
+        fz[i] = fzTotal;
+#endif
+    }
+}
+
+#if defined(DYANTRA_KERNEL_X86) && !defined(DYANTRA_PARTICLE_Z)
+
+// ---- SSE2, 4 particles per iteration ----
+
+inline __m128 fastExpSse(__m128 x) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 underflow = _mm_cmplt_ps(x, _mm_set1_ps(expLowerBound));
+    x = _mm_min_ps(x, _mm_set1_ps(expUpperBound));
+    x = _mm_max_ps(x, _mm_set1_ps(expLowerBound));
+
+    // fx = floor(x * log2e + 0.5), SSE2 has no floor instruction
+    __m128 t = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(log2e)), _mm_set1_ps(0.5f));
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(t));
+    __m128 fx = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, t), one));
+
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(expC1)));
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(expC2)));
+    __m128 z = _mm_mul_ps(x, x);
+    __m128 y = _mm_set1_ps(expP0);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(expP1));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(expP2));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(expP3));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(expP4));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(expP5));
+    y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, z), x), one);
+
+    __m128i n = _mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127));
+    __m128 pow2n = _mm_castsi128_ps(_mm_slli_epi32(n, 23));
+    return _mm_andnot_ps(underflow, _mm_mul_ps(y, pow2n));
+}
+
+inline __m128 exactExpSse(__m128 x) {
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, x);
+    for (int l = 0; l < 4; ++l) lanes[l] = std::exp(lanes[l]);
+    return _mm_load_ps(lanes);
+}
+
+template <int M>
+size_t gaussianForcesSse(const particleStreams& positions, particleStreams& forces, size_t begin, size_t end,
+                         const gaussianWell* wells, size_t nWells, forceKernelAccuracy accuracy) {
+    const float* x = positions.x.data();
+    const float* y = positions.y.data();
+    float* fx = forces.x.data();
+    float* fy = forces.y.data();
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    // M > 0: the well count is known at compile time, so the parameters are broadcast into registers once
+    // and the well loop below unrolls completely; M == 0 is the generic loop over nWells
+    const size_t count = M > 0 ? size_t(M) : nWells;
+    __m128 wellX[M > 0 ? M : 1], wellY[M > 0 ? M : 1], wellDenominator[M > 0 ? M : 1], wellCoefficient[M > 0 ? M : 1];
+    for (int k = 0; k < M; ++k) {
+        wellX[k] = _mm_set1_ps(wells[k].cx);
+        wellY[k] = _mm_set1_ps(wells[k].cy);
+        wellDenominator[k] = _mm_set1_ps(wells[k].expDenominator);
+        wellCoefficient[k] = _mm_set1_ps(wells[k].coefficient);
+    }
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 fxTotal = _mm_setzero_ps();
+        __m128 fyTotal = _mm_setzero_ps();
+        DYANTRA_UNROLL
+        for (size_t k = 0; k < count; ++k) {
+            __m128 dx = _mm_sub_ps(px, M > 0 ? wellX[k] : _mm_set1_ps(wells[k].cx));
+            __m128 dy = _mm_sub_ps(py, M > 0 ? wellY[k] : _mm_set1_ps(wells[k].cy));
+            __m128 num = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            __m128 arg = _mm_div_ps(num, M > 0 ? wellDenominator[k] : _mm_set1_ps(wells[k].expDenominator));
+            __m128 e = (accuracy == forceKernelAccuracy::exact) ? exactExpSse(arg) : fastExpSse(arg);
+            __m128 prefactor = _mm_xor_ps(_mm_mul_ps(M > 0 ? wellCoefficient[k] : _mm_set1_ps(wells[k].coefficient), e), signMask);
+            fxTotal = _mm_add_ps(fxTotal, _mm_mul_ps(prefactor, dx));
+            fyTotal = _mm_add_ps(fyTotal, _mm_mul_ps(prefactor, dy));
+        }
+        _mm_storeu_ps(fx + i, fxTotal);
+        _mm_storeu_ps(fy + i, fyTotal);
+    }
+    return i;
+}
+
+// ---- AVX2, 8 particles per iteration ----
+
+DYANTRA_TARGET_AVX2 inline __m256 fastExpAvx2(__m256 x) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 underflow = _mm256_cmp_ps(x, _mm256_set1_ps(expLowerBound), _CMP_LT_OQ);
+    x = _mm256_min_ps(x, _mm256_set1_ps(expUpperBound));
+    x = _mm256_max_ps(x, _mm256_set1_ps(expLowerBound));
+
+    __m256 fx = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(log2e)), _mm256_set1_ps(0.5f)));
+
+    x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(expC1)));
+    x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(expC2)));
+    __m256 z = _mm256_mul_ps(x, x);
+    __m256 y = _mm256_set1_ps(expP0);
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(expP1));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(expP2));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(expP3));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(expP4));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(expP5));
+    y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(y, z), x), one);
+
+    __m256i n = _mm256_add_epi32(_mm256_cvttps_epi32(fx), _mm256_set1_epi32(127));
+    __m256 pow2n = _mm256_castsi256_ps(_mm256_slli_epi32(n, 23));
+    return _mm256_andnot_ps(underflow, _mm256_mul_ps(y, pow2n));
+}
+
+DYANTRA_TARGET_AVX2 inline __m256 exactExpAvx2(__m256 x) {
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, x);
+    for (int l = 0; l < 8; ++l) lanes[l] = std::exp(lanes[l]);
+    return _mm256_load_ps(lanes);
+}
+
+template <int M>
+DYANTRA_TARGET_AVX2 size_t gaussianForcesAvx2(const particleStreams& positions, particleStreams& forces, size_t begin, size_t end,
+                                              const gaussianWell* wells, size_t nWells, forceKernelAccuracy accuracy) {
+    const float* x = positions.x.data();
+    const float* y = positions.y.data();
+    float* fx = forces.x.data();
+    float* fy = forces.y.data();
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const size_t count = M > 0 ? size_t(M) : nWells;
+    __m256 wellX[M > 0 ? M : 1], wellY[M > 0 ? M : 1], wellDenominator[M > 0 ? M : 1], wellCoefficient[M > 0 ? M : 1];
+    for (int k = 0; k < M; ++k) {
+        wellX[k] = _mm256_set1_ps(wells[k].cx);
+        wellY[k] = _mm256_set1_ps(wells[k].cy);
+        wellDenominator[k] = _mm256_set1_ps(wells[k].expDenominator);
+        wellCoefficient[k] = _mm256_set1_ps(wells[k].coefficient);
+    }
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i);
+        __m256 py = _mm256_loadu_ps(y + i);
+        __m256 fxTotal = _mm256_setzero_ps();
+        __m256 fyTotal = _mm256_setzero_ps();
+        DYANTRA_UNROLL
+        for (size_t k = 0; k < count; ++k) {
+            __m256 dx = _mm256_sub_ps(px, M > 0 ? wellX[k] : _mm256_set1_ps(wells[k].cx));
+            __m256 dy = _mm256_sub_ps(py, M > 0 ? wellY[k] : _mm256_set1_ps(wells[k].cy));
+            __m256 num = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+            __m256 arg = _mm256_div_ps(num, M > 0 ? wellDenominator[k] : _mm256_set1_ps(wells[k].expDenominator));
+            __m256 e = (accuracy == forceKernelAccuracy::exact) ? exactExpAvx2(arg) : fastExpAvx2(arg);
+            __m256 prefactor = _mm256_xor_ps(_mm256_mul_ps(M > 0 ? wellCoefficient[k] : _mm256_set1_ps(wells[k].coefficient), e), signMask);
+            fxTotal = _mm256_add_ps(fxTotal, _mm256_mul_ps(prefactor, dx));
+            fyTotal = _mm256_add_ps(fyTotal, _mm256_mul_ps(prefactor, dy));
+        }
+        _mm256_storeu_ps(fx + i, fxTotal);
+        _mm256_storeu_ps(fy + i, fyTotal);
+    }
+    return i;
+}
+
+// ---- AVX-512, 16 particles per iteration ----
+
+DYANTRA_TARGET_AVX512 inline __m512 fastExpAvx512(__m512 x) {
+    const __m512 one = _mm512_set1_ps(1.0f);
+    __mmask16 inRange = _mm512_cmp_ps_mask(x, _mm512_set1_ps(expLowerBound), _CMP_GE_OQ);
+    x = _mm512_min_ps(x, _mm512_set1_ps(expUpperBound));
+    x = _mm512_max_ps(x, _mm512_set1_ps(expLowerBound));
+
+    __m512 fx = _mm512_roundscale_ps(_mm512_add_ps(_mm512_mul_ps(x, _mm512_set1_ps(log2e)), _mm512_set1_ps(0.5f)),
+                                     _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+
+    x = _mm512_sub_ps(x, _mm512_mul_ps(fx, _mm512_set1_ps(expC1)));
+    x = _mm512_sub_ps(x, _mm512_mul_ps(fx, _mm512_set1_ps(expC2)));
+    __m512 z = _mm512_mul_ps(x, x);
+    __m512 y = _mm512_set1_ps(expP0);
+    y = _mm512_add_ps(_mm512_mul_ps(y, x), _mm512_set1_ps(expP1));
+    y = _mm512_add_ps(_mm512_mul_ps(y, x), _mm512_set1_ps(expP2));
+    y = _mm512_add_ps(_mm512_mul_ps(y, x), _mm512_set1_ps(expP3));
+    y = _mm512_add_ps(_mm512_mul_ps(y, x), _mm512_set1_ps(expP4));
+    y = _mm512_add_ps(_mm512_mul_ps(y, x), _mm512_set1_ps(expP5));
+    y = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(y, z), x), one);
+
+    __m512i n = _mm512_add_epi32(_mm512_cvttps_epi32(fx), _mm512_set1_epi32(127));
+    __m512 pow2n = _mm512_castsi512_ps(_mm512_slli_epi32(n, 23));
+    return _mm512_maskz_mul_ps(inRange, y, pow2n);
+}
+
+DYANTRA_TARGET_AVX512 inline __m512 exactExpAvx512(__m512 x) {
+    alignas(64) float lanes[16];
+    _mm512_store_ps(lanes, x);
+    for (int l = 0; l < 16; ++l) lanes[l] = std::exp(lanes[l]);
+    return _mm512_load_ps(lanes);
+}
+
+template <int M>
+DYANTRA_TARGET_AVX512 size_t gaussianForcesAvx512(const particleStreams& positions, particleStreams& forces, size_t begin, size_t end,
+                                                  const gaussianWell* wells, size_t nWells, forceKernelAccuracy accuracy) {
+    const float* x = positions.x.data();
+    const float* y = positions.y.data();
+    float* fx = forces.x.data();
+    float* fy = forces.y.data();
+    const __m512i signMask = _mm512_set1_epi32(static_cast<int32_t>(0x80000000u));
+    const size_t count = M > 0 ? size_t(M) : nWells;
+    __m512 wellX[M > 0 ? M : 1], wellY[M > 0 ? M : 1], wellDenominator[M > 0 ? M : 1], wellCoefficient[M > 0 ? M : 1];
+    for (int k = 0; k < M; ++k) {
+        wellX[k] = _mm512_set1_ps(wells[k].cx);
+        wellY[k] = _mm512_set1_ps(wells[k].cy);
+        wellDenominator[k] = _mm512_set1_ps(wells[k].expDenominator);
+        wellCoefficient[k] = _mm512_set1_ps(wells[k].coefficient);
+    }
+    size_t i = begin;
+    for (; i + 16 <= end; i += 16) {
+        __m512 px = _mm512_loadu_ps(x + i);
+        __m512 py = _mm512_loadu_ps(y + i);
+        __m512 fxTotal = _mm512_setzero_ps();
+        __m512 fyTotal = _mm512_setzero_ps();
+        DYANTRA_UNROLL
+        for (size_t k = 0; k < count; ++k) {
+            __m512 dx = _mm512_sub_ps(px, M > 0 ? wellX[k] : _mm512_set1_ps(wells[k].cx));
+            __m512 dy = _mm512_sub_ps(py, M > 0 ? wellY[k] : _mm512_set1_ps(wells[k].cy));
+            __m512 num = _mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy));
+            __m512 arg = _mm512_div_ps(num, M > 0 ? wellDenominator[k] : _mm512_set1_ps(wells[k].expDenominator));
+            __m512 e = (accuracy == forceKernelAccuracy::exact) ? exactExpAvx512(arg) : fastExpAvx512(arg);
+            __m512 product = _mm512_mul_ps(M > 0 ? wellCoefficient[k] : _mm512_set1_ps(wells[k].coefficient), e);
+            __m512 prefactor = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(product), signMask));
+            fxTotal = _mm512_add_ps(fxTotal, _mm512_mul_ps(prefactor, dx));
+            fyTotal = _mm512_add_ps(fyTotal, _mm512_mul_ps(prefactor, dy));
+        }
+        _mm512_storeu_ps(fx + i, fxTotal);
+        _mm512_storeu_ps(fy + i, fyTotal);
+    }
+    return i;
+}
+
+#endif // DYANTRA_KERNEL_X86
+
+#if defined(DYANTRA_KERNEL_NEON) && !defined(DYANTRA_PARTICLE_Z)
+
+// ---- NEON, 4 particles per iteration (Apple silicon / Windows on ARM) ----
+
+inline float32x4_t fastExpNeon(float32x4_t x) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    uint32x4_t inRange = vcgeq_f32(x, vdupq_n_f32(expLowerBound));
+    x = vminq_f32(x, vdupq_n_f32(expUpperBound));
+    x = vmaxq_f32(x, vdupq_n_f32(expLowerBound));
+
+    float32x4_t fx = vrndmq_f32(vaddq_f32(vmulq_f32(x, vdupq_n_f32(log2e)), vdupq_n_f32(0.5f)));
+
+    x = vsubq_f32(x, vmulq_f32(fx, vdupq_n_f32(expC1)));
+    x = vsubq_f32(x, vmulq_f32(fx, vdupq_n_f32(expC2)));
+    float32x4_t z = vmulq_f32(x, x);
+    float32x4_t y = vdupq_n_f32(expP0);
+    y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(expP1));
+    y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(expP2));
+    y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(expP3));
+    y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(expP4));
+    y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(expP5));
+    y = vaddq_f32(vaddq_f32(vmulq_f32(y, z), x), one);
+
+    int32x4_t n = vaddq_s32(vcvtq_s32_f32(fx), vdupq_n_s32(127));
+    float32x4_t pow2n = vreinterpretq_f32_s32(vshlq_n_s32(n, 23));
+    return vreinterpretq_f32_u32(vandq_u32(inRange, vreinterpretq_u32_f32(vmulq_f32(y, pow2n))));
+}
+
+inline float32x4_t exactExpNeon(float32x4_t x) {
+    float lanes[4];
+    vst1q_f32(lanes, x);
+    for (int l = 0; l < 4; ++l) lanes[l] = std::exp(lanes[l]);
+    return vld1q_f32(lanes);
+}
+
+template <int M>
+size_t gaussianForcesNeon(const particleStreams& positions, particleStreams& forces, size_t begin, size_t end,
+                          const gaussianWell* wells, size_t nWells, forceKernelAccuracy accuracy) {
+    const float* x = positions.x.data();
+    const float* y = positions.y.data();
+    float* fx = forces.x.data();
+    float* fy = forces.y.data();
+    const size_t count = M > 0 ? size_t(M) : nWells;
+    float32x4_t wellX[M > 0 ? M : 1], wellY[M > 0 ? M : 1], wellDenominator[M > 0 ? M : 1], wellCoefficient[M > 0 ? M : 1];
+    for (int k = 0; k < M; ++k) {
+        wellX[k] = vdupq_n_f32(wells[k].cx);
+        wellY[k] = vdupq_n_f32(wells[k].cy);
+        wellDenominator[k] = vdupq_n_f32(wells[k].expDenominator);
+        wellCoefficient[k] = vdupq_n_f32(wells[k].coefficient);
+    }
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        float32x4_t px = vld1q_f32(x + i);
+        float32x4_t py = vld1q_f32(y + i);
+        float32x4_t fxTotal = vdupq_n_f32(0.0f);
+        float32x4_t fyTotal = vdupq_n_f32(0.0f);
+        DYANTRA_UNROLL
+        for (size_t k = 0; k < count; ++k) {
+            float32x4_t dx = vsubq_f32(px, M > 0 ? wellX[k] : vdupq_n_f32(wells[k].cx));
+            float32x4_t dy = vsubq_f32(py, M > 0 ? wellY[k] : vdupq_n_f32(wells[k].cy));
+            float32x4_t num = vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy));
+            float32x4_t arg = vdivq_f32(num, M > 0 ? wellDenominator[k] : vdupq_n_f32(wells[k].expDenominator));
+            float32x4_t e = (accuracy == forceKernelAccuracy::exact) ? exactExpNeon(arg) : fastExpNeon(arg);
+            float32x4_t prefactor = vnegq_f32(vmulq_f32(M > 0 ? wellCoefficient[k] : vdupq_n_f32(wells[k].coefficient), e));
+            fxTotal = vaddq_f32(fxTotal, vmulq_f32(prefactor, dx));
+            fyTotal = vaddq_f32(fyTotal, vmulq_f32(prefactor, dy));
+        }
+        vst1q_f32(fx + i, fxTotal);
+        vst1q_f32(fy + i, fyTotal);
+    }
+    return i;
+}
+
+#endif // DYANTRA_KERNEL_NEON
+
+typedef size_t (*vectorKernel)(const particleStreams&, particleStreams&, size_t, size_t, const gaussianWell*, size_t, forceKernelAccuracy);
+
+// Index 0 is the generic loop, index M the kernel specialized for M wells
+#define DYANTRA_KERNEL_TABLE(kernel) { kernel<0>, kernel<1>, kernel<2>, kernel<3>, kernel<4>, kernel<5>, kernel<6>, kernel<7>, kernel<8> }
+
+#if defined(DYANTRA_KERNEL_X86) && !defined(DYANTRA_PARTICLE_Z)
+const vectorKernel sseKernels[maxUnrolledWells + 1] = DYANTRA_KERNEL_TABLE(gaussianForcesSse);
+const vectorKernel avx2Kernels[maxUnrolledWells + 1] = DYANTRA_KERNEL_TABLE(gaussianForcesAvx2);
+const vectorKernel avx512Kernels[maxUnrolledWells + 1] = DYANTRA_KERNEL_TABLE(gaussianForcesAvx512);
+#endif
+#if defined(DYANTRA_KERNEL_NEON) && !defined(DYANTRA_PARTICLE_Z)
+const vectorKernel neonKernels[maxUnrolledWells + 1] = DYANTRA_KERNEL_TABLE(gaussianForcesNeon);
+#endif
+
+bool isaSupported(forceKernelIsa isa) {
+#ifdef DYANTRA_PARTICLE_Z
+    return isa == forceKernelIsa::scalar;   // the vector paths are planar only
+#else
+    switch (isa) {
+        case forceKernelIsa::scalar:
+            return true;
+#ifdef DYANTRA_KERNEL_X86
+        case forceKernelIsa::sse2:
+            return true;
+#if defined(_MSC_VER) && !defined(__clang__)
+        case forceKernelIsa::avx2:
+        case forceKernelIsa::avx512: {
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) return false;
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            if (!osxsave) return false;
+            unsigned long long xcr0 = _xgetbv(0);
+            __cpuidex(info, 7, 0);
+            if (isa == forceKernelIsa::avx2) {
+                return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+            }
+            return (xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16)) != 0;
+        }
+#else
+        case forceKernelIsa::avx2:
+            return __builtin_cpu_supports("avx2");
+        case forceKernelIsa::avx512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+#endif
+#ifdef DYANTRA_KERNEL_NEON
+        case forceKernelIsa::neon:
+            return true;
+#endif
+        default:
+            return false;
+    }
+#endif
+}
+
+forceKernelIsa& activeIsa() {
+    static forceKernelIsa isa = detectForceKernelIsa();
+    return isa;
+}
+
+} // namespace
+
+bool sameWells(const std::vector<gaussianWell>& a, const std::vector<gaussianWell>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t k = 0; k < a.size(); ++k) {
+        if (a[k].cx != b[k].cx || a[k].cy != b[k].cy ||
+#ifdef DYANTRA_PARTICLE_Z
+            a[k].cz != b[k].cz ||
+#endif
+            a[k].coefficient != b[k].coefficient || a[k].expDenominator != b[k].expDenominator) {
+            return false;
+        }
+    }
+    return true;
+}
+
+forceKernelIsa detectForceKernelIsa() {
+    if (isaSupported(forceKernelIsa::avx512)) return forceKernelIsa::avx512;
+    if (isaSupported(forceKernelIsa::avx2)) return forceKernelIsa::avx2;
+    if (isaSupported(forceKernelIsa::sse2)) return forceKernelIsa::sse2;
+    if (isaSupported(forceKernelIsa::neon)) return forceKernelIsa::neon;
+    return forceKernelIsa::scalar;
+}
+
+forceKernelIsa getForceKernelIsa() {
+    return activeIsa();
+}
+
+void setForceKernelIsa(forceKernelIsa isa) {
+    activeIsa() = isaSupported(isa) ? isa : detectForceKernelIsa();
+}
+
+const char* forceKernelIsaName(forceKernelIsa isa) {
+    switch (isa) {
+        case forceKernelIsa::sse2: return "SSE2";
+        case forceKernelIsa::avx2: return "AVX2";
+        case forceKernelIsa::avx512: return "AVX-512";
+        case forceKernelIsa::neon: return "NEON";
+        default: return "scalar";
+    }
+}
+
+void computeGaussianForces(const particleStreams& positions, particleStreams& forces,
+                           size_t begin, size_t end,
+                           const gaussianWell* wells, size_t nWells,
+                           forceKernelAccuracy accuracy) {
+    size_t i = begin;
+    const size_t specialization = nWells <= size_t(maxUnrolledWells) ? nWells : 0;
+#if defined(DYANTRA_KERNEL_X86) && !defined(DYANTRA_PARTICLE_Z)
+    switch (activeIsa()) {
+        case forceKernelIsa::avx512: i = avx512Kernels[specialization](positions, forces, begin, end, wells, nWells, accuracy); break;
+        case forceKernelIsa::avx2: i = avx2Kernels[specialization](positions, forces, begin, end, wells, nWells, accuracy); break;
+        case forceKernelIsa::sse2: i = sseKernels[specialization](positions, forces, begin, end, wells, nWells, accuracy); break;
+        default: break;
+    }
+#elif defined(DYANTRA_KERNEL_NEON) && !defined(DYANTRA_PARTICLE_Z)
+    if (activeIsa() == forceKernelIsa::neon) {
+        i = neonKernels[specialization](positions, forces, begin, end, wells, nWells, accuracy);
+    }
+#endif
+    // whatever did not fill a whole vector (or everything, on the scalar path)
+    gaussianForcesScalar(positions, forces, i, end, wells, nWells, accuracy);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "particleStreams.h"
+
+// Parameters of one Gaussian attractor, hoisted out of the particle loop once per step
+struct gaussianWell {
+    float cx, cy;
+#ifdef DYANTRA_PARTICLE_Z
+    float cz;
+#endif
+    float coefficient;      // amplitude / radius^2           (attractor::get_coefficient)
+    float expDenominator;   // -2 * radius^2                  (attractor::get_exp_denominator)
+};
+
+// Instruction sets the force kernel can run on, picked at runtime from what the CPU supports
+enum class forceKernelIsa {
+    scalar,
+    sse2,
+    avx2,
+    avx512,
+    neon
+};
+
+// exact: every lane calls std::exp, results are bit-identical to the scalar loop
+// fast:  polynomial exp approximation, evaluated in the vector registers; forces differ from exact mode by up to
+//        about 4e-5 relative, and exponents below -86 flush to 0 instead of going denormal
+enum class forceKernelAccuracy {
+    exact,
+    fast
+};
+
+// Writes the summed Gaussian force of all wells into forces[i] for particles i in [begin, end)
+void computeGaussianForces(const particleStreams& positions, particleStreams& forces,
+                           size_t begin, size_t end,
+                           const gaussianWell* wells, size_t nWells,
+                           forceKernelAccuracy accuracy);
+
+// True if both lists describe the same wells in the same order (used to skip rebuilding derived tables)
+bool sameWells(const std::vector<gaussianWell>& a, const std::vector<gaussianWell>& b);
+
+forceKernelIsa detectForceKernelIsa();          // best instruction set available on this machine
+forceKernelIsa getForceKernelIsa();             // instruction set currently used by computeGaussianForces
+void setForceKernelIsa(forceKernelIsa isa);     // force a specific path (clamped to what the CPU supports)
+const char* forceKernelIsaName(forceKernelIsa isa);
@@ -0,0 +1,171 @@
+#include "frameProfiler.h"
+#include <fstream>
+#include <iomanip>
+
+frameProfiler::frameProfiler() {
+    history.resize(historySize);
+    current = frameSample();
+}
+
+void frameProfiler::beginFrame() {
+    auto now = std::chrono::steady_clock::now();
+    if (frameStarted) {
+        current.frameMs = std::chrono::duration<float, std::milli>(now - frameStart).count();
+        history[nextSample] = current;
+        nextSample = (nextSample + 1) % historySize;
+        nSamples = std::min(nSamples + 1, historySize);
+    }
+    current = frameSample();
+    frameStart = now;
+    frameStarted = true;
+}
+
+const frameProfiler::frameSample& frameProfiler::sample(size_t age) const {
+    return history[(nextSample + historySize - 1 - age) % historySize];
+}
+
+const char* frameProfiler::phaseName(profilePhase phase) {
+    switch (phase) {
+        case profilePhase::potentialField: return "potential field";
+        case profilePhase::contours:       return "contours";
+        case profilePhase::guiSync:        return "gui sync";
+        case profilePhase::integrator:     return "integrator";
+        case profilePhase::sequence:       return "sequence";
+        case profilePhase::drawField:      return "draw field";
+        case profilePhase::drawContours:   return "draw contours";
+        case profilePhase::drawParticles:  return "draw particles";
+        case profilePhase::drawSkeleton:   return "draw skeleton";
+        case profilePhase::drawGui:        return "draw gui";
+        default:                           return "";
+    }
+}
+
+ofColor frameProfiler::phaseColor(profilePhase phase) {
+    // update phases in warm colors, draw phases in cool ones
+    switch (phase) {
+        case profilePhase::potentialField: return ofColor(230, 85, 60);
+        case profilePhase::contours:       return ofColor(240, 150, 50);
+        case profilePhase::guiSync:        return ofColor(235, 210, 70);
+        case profilePhase::integrator:     return ofColor(200, 60, 140);
+        case profilePhase::sequence:       return ofColor(150, 100, 60);
+        case profilePhase::drawField:      return ofColor(60, 130, 220);
+        case profilePhase::drawContours:   return ofColor(70, 190, 220);
+        case profilePhase::drawParticles:  return ofColor(80, 200, 120);
+        case profilePhase::drawSkeleton:   return ofColor(140, 110, 220);
+        case profilePhase::drawGui:        return ofColor(170, 170, 190);
+        default:                           return ofColor(255);
+    }
+}
+
+void frameProfiler::drawOverlay(float x, float y, float width, float height) const {
+    ofPushStyle();
+    ofFill();
+    ofSetColor(0, 0, 0, 180);
+    ofDrawRectangle(x, y, width, height);
+
+    // twice the budget fills the panel
+    const float msToPixels = height / (2.0f * frameBudgetMs);
+    const float barWidth = width / historySize;
+    const float bottom = y + height;
+
+    // all bars go into one mesh, a few thousand rectangles are too many for ofDrawRectangle every frame
+    ofMesh bars;
+    bars.setMode(OF_PRIMITIVE_TRIANGLES);
+    auto addBar = [&](float left, float top, float barHeight, const ofColor& color) {
+        if (barHeight <= 0) return;
+        top = std::max(top, y);
+        float right = left + std::max(barWidth, 1.0f);
+        float lower = std::min(top + barHeight, bottom);
+        const glm::vec3 corners[6] = {{left, top, 0}, {right, top, 0}, {right, lower, 0},
+                                      {left, top, 0}, {right, lower, 0}, {left, lower, 0}};
+        for (const auto& corner : corners) {
+            bars.addVertex(corner);
+            bars.addColor(color);
+        }
+    };
+    for (size_t age = 0; age < nSamples; ++age) {
+        const frameSample& s = sample(age);
+        float left = x + width - (age + 1) * barWidth;
+        float top = bottom;
+        float trackedMs = 0;
+        for (int p = 0; p < nPhases; ++p) {
+            float barHeight = s.phaseMs[p] * msToPixels;
+            top -= barHeight;
+            addBar(left, top, barHeight, phaseColor(profilePhase(p)));
+            trackedMs += s.phaseMs[p];
+        }
+        // the rest of the frame (swap, events, untimed code) in gray on top
+        float untracked = std::max(s.frameMs - trackedMs, 0.0f) * msToPixels;
+        addBar(left, top - untracked, untracked, ofColor(90, 90, 90));
+    }
+    bars.draw();
+
+    // budget line
+    ofSetColor(255, 60, 60);
+    ofDrawLine(x, bottom - frameBudgetMs * msToPixels, x + width, bottom - frameBudgetMs * msToPixels);
+
+    // legend with the latest frame's numbers
+    float textY = y + 14;
+    if (nSamples > 0) {
+        const frameSample& latest = sample(0);
+        ofSetColor(255);
+        ofDrawBitmapString("frame " + ofToString(latest.frameMs, 2) + " ms  (budget " + ofToString(frameBudgetMs, 1) + ")", x + 6, textY);
+        for (int p = 0; p < nPhases; ++p) {
+            textY += 13;
+            ofSetColor(phaseColor(profilePhase(p)));
+            ofDrawBitmapString(std::string(phaseName(profilePhase(p))) + " " + ofToString(latest.phaseMs[p], 2), x + 6, textY);
+        }
+    }
+    ofPopStyle();
+}
+
+bool frameProfiler::writeCsv(const std::string& filename) const {
+    std::ofstream file(ofToDataPath(filename));
+    if (!file.is_open()) {
+        ofLogError("frameProfiler") << "Unable to open file for writing: " << filename;
+        return false;
+    }
+
+    // one column of samples per phase, then the untracked rest and the whole frame
+    const int nColumns = nPhases + 2;
+    std::vector<std::vector<float>> columns(nColumns);
+    std::vector<int> largestInSlowFrames(nColumns, 0);
+    int nSlowFrames = 0;
+    for (size_t age = 0; age < nSamples; ++age) {
+        const frameSample& s = sample(age);
+        float trackedMs = 0;
+        int largest = 0;
+        for (int p = 0; p < nPhases; ++p) {
+            columns[p].push_back(s.phaseMs[p]);
+            trackedMs += s.phaseMs[p];
+            if (s.phaseMs[p] > s.phaseMs[largest]) largest = p;
+        }
+        float untrackedMs = std::max(s.frameMs - trackedMs, 0.0f);
+        columns[nPhases].push_back(untrackedMs);
+        columns[nPhases + 1].push_back(s.frameMs);
+        if (s.frameMs > frameBudgetMs) {
+            ++nSlowFrames;
+            ++largestInSlowFrames[untrackedMs > s.phaseMs[largest] ? nPhases : largest];
+        }
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "phase,mean_ms,p50_ms,p90_ms,p99_ms,max_ms,largest_in_slow_frames\n";
+    for (int c = 0; c < nColumns; ++c) {
+        std::vector<float>& values = columns[c];
+        std::sort(values.begin(), values.end());
+        auto percentile = [&](float q) {
+            return values.empty() ? 0.0f : values[std::min(values.size() - 1, size_t(q * values.size()))];
+        };
+        double sum = 0;
+        for (float v : values) sum += v;
+        std::string name = c < nPhases ? phaseName(profilePhase(c)) : (c == nPhases ? "untracked" : "frame");
+        file << name << "," << (values.empty() ? 0.0 : sum / values.size()) << "," << percentile(0.5f) << ","
+             << percentile(0.9f) << "," << percentile(0.99f) << "," << (values.empty() ? 0.0f : values.back()) << ",";
+        if (c <= nPhases) file << largestInSlowFrames[c];
+        else file << nSlowFrames;
+        file << "\n";
+    }
+    ofLogNotice("frameProfiler") << nSamples << " frames written to " << filename;
+    return true;
+}
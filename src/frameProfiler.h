@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ofMain.h"
+#include <chrono>
+#include "traceRecorder.h"
+
+// Phases of ofApp::update and ofApp::draw that the profiler times
+enum class profilePhase {
+    potentialField,
+    contours,
+    guiSync,
+    integrator,
+    sequence,
+    drawField,
+    drawContours,
+    drawParticles,
+    drawSkeleton,
+    drawGui,
+    count
+};
+
+// Per-frame timers for the app's hot paths.
+// Every frame gets one sample holding the time spent in each phase plus the whole frame (beginFrame to beginFrame,
+// so it includes the buffer swap); the last historySize samples are kept in a ring buffer.
+// Draw phases measure the CPU time spent issuing GL calls, not GPU time.
+class frameProfiler {
+public:
+    static const int nPhases = int(profilePhase::count);
+    static const size_t historySize = 600;  // 10 s at 60 fps
+
+    // Adds the time between its construction and destruction to a phase of the current frame,
+    // and to the trace while a trace capture runs
+    class scopedTimer {
+    public:
+        scopedTimer(frameProfiler& profiler, profilePhase phase)
+            : profiler(profiler), phase(phase), tracing(traceRecorder::isRecording()), start(std::chrono::steady_clock::now()) {
+            if (tracing) traceRecorder::begin(phaseName(phase));
+        }
+        ~scopedTimer() {
+            profiler.add(phase, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+            if (tracing) traceRecorder::end(phaseName(phase));
+        }
+    private:
+        frameProfiler& profiler;
+        profilePhase phase;
+        bool tracing;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    frameProfiler();
+
+    void beginFrame();  // closes the previous frame's sample; call first thing in update()
+    void add(profilePhase phase, float milliseconds) { current.phaseMs[int(phase)] += milliseconds; }
+    scopedTimer time(profilePhase phase) { return scopedTimer(*this, phase); }
+
+    // Stacked bar per frame, newest on the right, with the 60 fps budget marked
+    void drawOverlay(float x, float y, float width, float height) const;
+
+    // mean, percentiles and max of every phase over the history, and how often each phase was the largest one in
+    // frames that went over budget
+    bool writeCsv(const std::string& filename) const;
+
+    static const char* phaseName(profilePhase phase);
+    static ofColor phaseColor(profilePhase phase);
+
+    float frameBudgetMs = 1000.0f / 60.0f;
+
+private:
+    struct frameSample {
+        float phaseMs[nPhases];
+        float frameMs;
+    };
+    const frameSample& sample(size_t age) const;  // 0 = most recent complete frame
+
+    std::vector<frameSample> history;
+    size_t nextSample = 0;
+    size_t nSamples = 0;
+    frameSample current;
+    std::chrono::steady_clock::time_point frameStart;
+    bool frameStarted = false;
+};
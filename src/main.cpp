@@ -1,7 +1,25 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "batchRunner.h"
+#include "benchmarkRunner.h"
+#include "compiledSkeleton.h"
+
+int main(int argc, char* argv[]) {
+	// dyantra --batch runs sequence files headless, see batchRunner.h
+	if (batchRunner::isBatchCommandLine(argc, argv)) {
+		batchRunner runner;
+		return runner.run(argc, argv);
+	}
+	// dyantra --bench times the hot paths, see benchmarkRunner.h
+	if (benchmarkRunner::isBenchmarkCommandLine(argc, argv)) {
+		benchmarkRunner runner;
+		return runner.run(argc, argv);
+	}
+	// dyantra --compile-skeleton writes a .dyskel, see compiledSkeleton.h
+	if (compiledSkeleton::isCompileCommandLine(argc, argv)) {
+		return compiledSkeleton::compileCommandLine(argc, argv);
+	}
 
-int main() {
 	//Use ofGLFWWindowSettings for more options like multi-monitor fullscreen
 	ofGLWindowSettings settings;
 	settings.setSize(1024, 768);
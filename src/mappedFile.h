@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file in memory. Pages are read in as they are touched, so opening is cheap however
+// large the file, and a loader can use the data in place or memcpy what it needs out of it.
+class mappedFile {
+public:
+    mappedFile() {}
+    ~mappedFile() { close(); }
+
+    mappedFile(const mappedFile&) = delete;
+    mappedFile& operator=(const mappedFile&) = delete;
+
+    bool open(const std::string& path);     // a full path, see ofToDataPath; false for a missing or empty file
+    void close();
+    bool isOpen() const { return data != nullptr; }
+
+    const unsigned char* getData() const { return data; }
+    size_t getSize() const { return size; }
+
+private:
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+};
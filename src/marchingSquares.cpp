@@ -0,0 +1,136 @@
+#include "marchingSquares.h"
+
+namespace {
+    const int rowsPerBand = 32;
+}
+
+void marchingSquares::extract(const std::vector<float>& grid, int width, int height, float spacing,
+                              const std::vector<float>& thresholds, std::vector<ofPolyline>& lines, workerPool* pool) {
+    if (width < 2 || height < 2 || grid.size() < size_t(width) * height) return;
+
+    const int cellRows = height - 1;
+    const int nBands = (cellRows + rowsPerBand - 1) / rowsPerBand;
+    bandSegments.resize(nBands);
+
+    for (float threshold : thresholds) {
+        workerPool::parallelFor(pool, nBands, 1, [&](size_t begin, size_t end) {
+            for (size_t band = begin; band < end; ++band) {
+                bandSegments[band].clear();
+                int y0 = int(band) * rowsPerBand;
+                int y1 = std::min(y0 + rowsPerBand, cellRows);
+                classifyRows(grid, width, y0, y1, threshold, bandSegments[band]);
+            }
+        });
+
+        segments.clear();
+        for (const auto& band : bandSegments) {
+            segments.insert(segments.end(), band.begin(), band.end());
+        }
+        stitch(grid, width, spacing, threshold, lines);
+    }
+}
+
+void marchingSquares::classifyRows(const std::vector<float>& grid, int width, int y0, int y1, float threshold, std::vector<segment>& out) const {
+    for (int y = y0; y < y1; ++y) {
+        const float* top = &grid[size_t(y) * width];
+        const float* bottom = top + width;
+        for (int x = 0; x + 1 < width; ++x) {
+            // corner bits: 1 top-left, 2 top-right, 4 bottom-right, 8 bottom-left
+            int cell = (top[x] >= threshold ? 1 : 0) | (top[x + 1] >= threshold ? 2 : 0) |
+                       (bottom[x + 1] >= threshold ? 4 : 0) | (bottom[x] >= threshold ? 8 : 0);
+            if (cell == 0 || cell == 15) continue;
+
+            const uint64_t p = uint64_t(y) * width + x;
+            const uint64_t topEdge = 2 * p;
+            const uint64_t leftEdge = 2 * p + 1;
+            const uint64_t bottomEdge = 2 * (p + width);
+            const uint64_t rightEdge = 2 * (p + 1) + 1;
+
+            switch (cell) {
+                case 1: case 14: out.push_back({leftEdge, topEdge}); break;
+                case 2: case 13: out.push_back({topEdge, rightEdge}); break;
+                case 3: case 12: out.push_back({leftEdge, rightEdge}); break;
+                case 4: case 11: out.push_back({rightEdge, bottomEdge}); break;
+                case 6: case 9:  out.push_back({topEdge, bottomEdge}); break;
+                case 7: case 8:  out.push_back({leftEdge, bottomEdge}); break;
+                case 5: case 10: {
+                    // saddle: the cell centre decides which diagonal pair of corners is connected
+                    float centre = 0.25f * (top[x] + top[x + 1] + bottom[x] + bottom[x + 1]);
+                    bool centreInside = centre >= threshold;
+                    if ((cell == 5) == centreInside) {
+                        out.push_back({leftEdge, bottomEdge});
+                        out.push_back({topEdge, rightEdge});
+                    }
+                    else {
+                        out.push_back({leftEdge, topEdge});
+                        out.push_back({rightEdge, bottomEdge});
+                    }
+                    break;
+                }
+            }
+        }
+    }
+}
+
+glm::vec3 marchingSquares::edgePoint(const std::vector<float>& grid, int width, uint64_t edge, float spacing, float threshold) const {
+    const uint64_t p = edge / 2;
+    const int x = int(p % width);
+    const int y = int(p / width);
+    const bool vertical = (edge & 1) != 0;
+    const float a = grid[p];
+    const float b = vertical ? grid[p + width] : grid[p + 1];
+    float t = (b != a) ? (threshold - a) / (b - a) : 0.5f;
+    t = ofClamp(t, 0.0f, 1.0f);
+    if (vertical) {
+        return glm::vec3(x * spacing, (y + t) * spacing, 0);
+    }
+    return glm::vec3((x + t) * spacing, y * spacing, 0);
+}
+
+void marchingSquares::stitch(const std::vector<float>& grid, int width, float spacing, float threshold, std::vector<ofPolyline>& lines) {
+    edgeToSegments.clear();
+    edgeToSegments.reserve(segments.size() * 2);
+    for (int i = 0; i < int(segments.size()); ++i) {
+        for (uint64_t edge : {segments[i].edgeA, segments[i].edgeB}) {
+            auto it = edgeToSegments.find(edge);
+            if (it == edgeToSegments.end()) {
+                edgeToSegments.emplace(edge, std::make_pair(i, -1));
+            }
+            else {
+                it->second.second = i;
+            }
+        }
+    }
+    used.assign(segments.size(), 0);
+
+    // Follows segments from startEdge onwards until the line ends at the grid border or comes back to where it started
+    auto follow = [&](int first, uint64_t startEdge) {
+        ofPolyline line;
+        line.addVertex(edgePoint(grid, width, startEdge, spacing, threshold));
+        int current = first;
+        uint64_t edge = startEdge;
+        while (current >= 0 && !used[current]) {
+            used[current] = 1;
+            edge = (segments[current].edgeA == edge) ? segments[current].edgeB : segments[current].edgeA;
+            line.addVertex(edgePoint(grid, width, edge, spacing, threshold));
+            const std::pair<int, int>& shared = edgeToSegments[edge];
+            current = (shared.first == current) ? shared.second : shared.first;
+        }
+        if (edge == startEdge && line.size() > 2) {
+            line.getVertices().pop_back();  // the loop came back to its first vertex
+            line.setClosed(true);
+        }
+        lines.push_back(line);
+    };
+
+    // open lines first, starting from the edge that has no neighbour...
+    for (int i = 0; i < int(segments.size()); ++i) {
+        if (used[i]) continue;
+        if (edgeToSegments[segments[i].edgeA].second < 0) follow(i, segments[i].edgeA);
+        else if (edgeToSegments[segments[i].edgeB].second < 0) follow(i, segments[i].edgeB);
+    }
+    // ...then whatever is left forms closed loops
+    for (int i = 0; i < int(segments.size()); ++i) {
+        if (!used[i]) follow(i, segments[i].edgeA);
+    }
+}
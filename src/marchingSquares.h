@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ofMain.h"
+#include "workerPool.h"
+
+// Iso-line extraction over a row-major float grid. Cells are classified in parallel row bands, every crossing is
+// placed by linear interpolation along its grid edge, and the segments are then stitched into connected polylines.
+class marchingSquares {
+public:
+    // Appends the contour lines of grid at each threshold to lines; grid cell (x, y) maps to (x * spacing, y * spacing).
+    // The row bands are classified on pool, or on the calling thread without one.
+    void extract(const std::vector<float>& grid, int width, int height, float spacing,
+                 const std::vector<float>& thresholds, std::vector<ofPolyline>& lines, workerPool* pool = nullptr);
+
+private:
+    // A segment runs between two cell edges, identified by key: 2 * (y * width + x) for the horizontal edge leaving
+    // grid point (x, y) to the right, +1 for the vertical edge leaving it downwards
+    struct segment {
+        uint64_t edgeA;
+        uint64_t edgeB;
+    };
+
+    void classifyRows(const std::vector<float>& grid, int width, int y0, int y1, float threshold, std::vector<segment>& out) const;
+    glm::vec3 edgePoint(const std::vector<float>& grid, int width, uint64_t edge, float spacing, float threshold) const;
+    void stitch(const std::vector<float>& grid, int width, float spacing, float threshold, std::vector<ofPolyline>& lines);
+
+    std::vector<std::vector<segment>> bandSegments;  // one list per row band
+    std::vector<segment> segments;
+    std::unordered_map<uint64_t, std::pair<int, int>> edgeToSegments;  // the (at most two) segments sharing an edge
+    std::vector<char> used;
+};
@@ -26,6 +26,7 @@ ofPoint ofApp::getNearestSvgVertex(const ofPoint& point, float& minDistance) {
 
 
 void ofApp::setup() {
+    traceRecorder::setThreadName("main");
     
     ofSetVerticalSync(false);
 //    ofSetFrameRate(60);
@@ -49,13 +50,10 @@ void ofApp::setup() {
     timestep = 0.003;
     gridSpacing = 50; // Set grid spacing
     numSpokes = 16;
-    last_timeStep = timestep;
     
-    timeReversalInProgress = false;
-    nTimeReversalSteps = 120; // Adjust this value as needed
-    timeReversalStepCounter = nTimeReversalSteps;
-    nTimeReversalCalls = 0;
     timeReversalTimestep = 2000;      // Initialize the timestep for reversal
+    scheduledReversalTimestep = timeReversalTimestep;
+    schedule.reversalTimestep = timeReversalTimestep;
     timeReversalValueChanged = false;
     
     drawingAttractor = false;
@@ -70,6 +68,8 @@ void ofApp::setup() {
     int width = ofGetWidth() / downscaleFactor;
     int height = ofGetHeight() / downscaleFactor;
     potentialField.allocate(width, height, OF_IMAGE_GRAYSCALE);
+    attractorField.invalidatePotentialField();
+    attractorField.setWorkerPool(&particleEnsemble.getWorkerPool());  // on its own while the simulation thread steps
     potentialFieldUpdated = true;
     showPotentialField = true; // Initialize the flag to show the potential field
     contourLinesUpdated = true; // Initialize the flag to update contour lines
@@ -88,6 +88,7 @@ void ofApp::setup() {
     nPauseSteps = 300;
     numStepsSequenceFileRun = 0;
     
+    svgSkeleton.setWorkerPool(&particleEnsemble.getWorkerPool());
     svgSkeleton.loadSvg(svgFile);
     svgSkeleton.generateEquidistantPoints(numPoints); // Call with the data member
     svgSkeleton.autoFitToWindow(ofGetWidth(), ofGetHeight());
@@ -96,9 +97,6 @@ void ofApp::setup() {
     // GUI setup
     gui.setup();
     
-    elapsedTimesteps = 0;  // Initialize elapsed timesteps counter
-    timeForward = true;  // Initialize time direction to forward
-    
     // Initialize new parameters
     gui.add(windowSize.set("Window Size", ""));
     gui.add(fpsDisplay.set("FPS", "")); // Add FPS display
@@ -111,13 +109,13 @@ void ofApp::setup() {
     gui.add(timeDirectionDisplay.set("Time Direction", "FORWARD"));        // Add time direction to the GUI
 
     // Add the timestep input field
-    gui.add(timestepLabel_1.set("timestep [0.0002-0.01]", ""));
+    gui.add(timestepLabel_1.set("timestep [0.0002-0.01, 4th order 0.03]", ""));
     gui.add(timestepLabel_2.set("         [default=0.003]", ""));
-    gui.add(timestepInput.setup("Edit timestep", timestep, 0.0002, 0.01));
+    gui.add(timestepInput.setup("Edit timestep", timestep, 0.0002, 0.03));   // above 0.01 only with a 4th order scheme, see update()
     timestepInput.addListener(this, &ofApp::onTimestepChanged);
     
     // Add elapsed timesteps to the GUI
-    gui.add(elapsedTimestepsDisplay.set("Elapsed Steps", ofToString(elapsedTimesteps)));
+    gui.add(elapsedTimestepsDisplay.set("Elapsed Steps", ofToString(schedule.elapsedTimesteps)));
     gui.add(timeReversalStatus.set("Time is reversing:", "FALSE"));  // Add this for displaying time reversal status
     
     
@@ -138,6 +136,28 @@ void ofApp::setup() {
 
     gui.add(showGrid.set("Show Grid", true));  // Add the checkbox for the grid
 	gui.add(vboParticles.set("VBO Particles", false));
+    gui.add(fastExpForces.set("Fast Exp Forces", false));
+    gui.add(forceKernelDisplay.set("Force Kernel", forceKernelIsaName(getForceKernelIsa())));
+    gui.add(simulationThreadsGui.set("Simulation Threads", workerPool::hardwareThreads(), 1, workerPool::hardwareThreads()));
+    particleEnsemble.setThreadCount(simulationThreadsGui);
+    gui.add(fusedIntegrator.set("Fused Integrator", true));
+    gui.add(integratorSchemeGui.set("Integrator Scheme", 0, 0, 3));
+    gui.add(integratorSchemeDisplay.set("Scheme", integratorModeName(integratorMode::fusedVelocityVerlet)));
+    gui.add(forceGridThresholdGui.set("Force Grid Above", 32, 0, 512));
+    gui.add(forceGridToleranceGui.set("Force Grid Tolerance", 0.001, 0.0001, 0.05));
+    gui.add(attractorCutoffGui.set("Attractor Cutoff (sigma)", 0.0, 0.0, 20.0));
+    gui.add(traceFramesGui.set("Trace Frames", 120, 1, 3600));
+    gui.add(simulationThreadGui.set("Simulation Thread", true));
+    gui.add(simulationRateGui.set("Simulation Rate (Hz)", 60, 0, 2000));   // 0 = as fast as possible
+    gui.add(checkpointMemoryGui.set("Checkpoint Memory (MB)", 256, 0, 4096));
+    gui.add(timelineStepGui.set("Timeline Step", 0, 0, 0));
+    gui.add(timelineDisplay.set("Checkpoints", "0"));
+    gui.add(recordIntervalGui.set("Record Every (steps)", 1, 1, 100));
+    gui.add(recordPrecisionGui.set("Record Precision (px)", 0.01, 0.001, 1.0));
+    gui.add(recordingDisplay.set("Recording", "off"));
+    gui.add(replaySpeedGui.set("Replay Speed (fps)", 60, -600, 600));
+    gui.add(replayFrameGui.set("Replay Frame", 0, 0, 0));
+    gui.add(skeletonCacheGui.set("Skeleton Cache (MB)", 256, 0, 4096));
     regenerateGridIntersections();  // Generate initial grid intersections
     
     // Setup GUI for snapping
@@ -189,7 +209,26 @@ void ofApp::setup() {
     
 }
 
+// Whether two attractor lists exert the same forces
+static bool sameAttractors(const std::vector<attractor>& a, const std::vector<attractor>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].getCenter() != b[i].getCenter() || a[i].getRadius() != b[i].getRadius()
+            || a[i].getAmplitude() != b[i].getAmplitude()) return false;
+    }
+    return true;
+}
+
 void ofApp::update() {
+    profiler.beginFrame();
+    if (traceRecorder::frameBoundary()) {
+        std::string filename = "trace_" + ofGetTimestampString("%Y-%m-%d_%H-%M-%S") + ".json";
+        if (traceRecorder::write(ofToDataPath(filename))) {
+            ofLogNotice() << "Trace written to " << filename;
+        } else {
+            ofLogError() << "Unable to open file for writing: " << filename;
+        }
+    }
     
     // Synchronize GUI checkbox with showPotentialField variable
     showPotentialField = showPotentialFieldGui;
@@ -198,101 +237,287 @@ void ofApp::update() {
     if (downscaleFactor != downscaleFactorGui) {
         downscaleFactor = downscaleFactorGui;
         potentialField.allocate(ofGetWidth() / downscaleFactor, ofGetHeight() / downscaleFactor, OF_IMAGE_GRAYSCALE);
+        attractorField.invalidatePotentialField();
         potentialFieldUpdated = true;
         contourLinesUpdated = true;
     }
     
+    // Start or stop the integrator thread; while it runs, draw() shows the positions it publishes
+    if (simulationThreadGui != simulation.isRunning()) {
+        if (simulationThreadGui) {
+            particleEnsemble.setSnapshotDrawing(true);
+            simulation.start([this] { return simulationStep(); });
+        } else {
+            simulation.stop();
+            particleEnsemble.setSnapshotDrawing(false);
+        }
+    }
+    simulation.setRate(simulationRateGui);
+
+    // Update the number of integrator threads
+    if (particleEnsemble.getThreadCount() != simulationThreadsGui) {
+        auto lock = simulation.lockState();
+        particleEnsemble.setThreadCount(simulationThreadsGui);
+    }
+    
+    skeletonCache::shared().setBudget(size_t(skeletonCacheGui) << 20);
+
     // Check if the number of points has changed
     if (!isPlaying && numPoints != numPointsInput) {
         numPoints = numPointsInput;
         svgSkeleton.generateEquidistantPoints(numPoints);
         svgSkeleton.calculateSvgMidpoint();
+        auto lock = simulation.lockState();
         particleEnsemble.initialize(svgSkeleton.getEquidistantPoints());
     }
     
     if (potentialFieldUpdated) {
+        auto timer = profiler.time(profilePhase::potentialField);
         calculatePotentialField();
         potentialFieldUpdated = false;
     }
 
     if (contourLinesUpdated) {
+        auto timer = profiler.time(profilePhase::contours);
         updateContours();
         contourLinesUpdated = false;
     }
 
-    // Update FPS display
-    float fps = ofGetFrameRate();
-    fpsDisplay = ofToString(fps, 2);
+    {   // GUI display sync
+        auto timer = profiler.time(profilePhase::guiSync);
+
+        // Update FPS display
+        float fps = ofGetFrameRate();
+        fpsDisplay = ofToString(fps, 2);
     
-    // Update number of points display
-    numPointsDisplay = ofToString(svgSkeleton.getEquidistantPoints().size());
+        // Update number of points display
+        numPointsDisplay = ofToString(svgSkeleton.getEquidistantPoints().size());
     
-    // Update window size display
-    windowSize = ofToString(ofGetWidth()) + "x" + ofToString(ofGetHeight());
+        // Update window size display
+        windowSize = ofToString(ofGetWidth()) + "x" + ofToString(ofGetHeight());
 
-    // Update play/pause status
-    playPauseStatus = isPlaying ? "Play" : "Pause";
+        // Update play/pause status
+        playPauseStatus = isPlaying ? "Play" : "Pause";
     
-    // Update SVG midpoint display
-    svgMidpoint = ofVec2f(svgSkeleton.getSvgCentroid().x, svgSkeleton.getSvgCentroid().y);
+        // Update SVG midpoint display
+        svgMidpoint = ofVec2f(svgSkeleton.getSvgCentroid().x, svgSkeleton.getSvgCentroid().y);
     
-    // Update SVG scale display
-    svgScale = svgSkeleton.getCumulativeScale();
+        // Update SVG scale display
+        svgScale = svgSkeleton.getCumulativeScale();
     
-    // Update the SVG rotation angle
-    svgRotationAngle = ofRadToDeg(svgSkeleton.getCurrentRotationAngle());
+        // Update the SVG rotation angle
+        svgRotationAngle = ofRadToDeg(svgSkeleton.getCurrentRotationAngle());
     
-    if (timeReversalValueChanged){
-        timeReversalTimestepInput = timeReversalTimestep;
-        timeReversalValueChanged = false;
-    }
+        if (timeReversalValueChanged){
+            timeReversalTimestepInput = timeReversalTimestep;
+            timeReversalValueChanged = false;
+        }
 
-    // Update GUI elements for attractors       
-    for (size_t i = 0; i < attractorField.getAttractors().size(); ++i) {
-        updateAttractorGui(i, attractorField.getAttractors()[i]);
+        // Update GUI elements for attractors       
+        for (size_t i = 0; i < attractorField.getAttractors().size(); ++i) {
+            updateAttractorGui(i, attractorField.getAttractors()[i]);
+        }
     }
         
-    // Handle particle motion if playing
-    if (isPlaying) {
-        float dt;
-        if (timeReversalInProgress) {
-            dt = gentlyReverseTimeWithCos();
-            timeReversalStatus = "TRUE";
+    // Hand the GUI state to the integrator, and step it here if it has no thread of its own
+    {
+        auto timer = profiler.time(profilePhase::integrator);
+        auto lock = simulation.lockState();
+
+        // a step that starts a reversal flips the reversal step, show that before handing the GUI value back
+        if (schedule.reversalTimestep != scheduledReversalTimestep) {
+            timeReversalTimestepInput = schedule.reversalTimestep;
         }
-        else {
-/*
-            if (timeForward) {dt = timestep;}
-            else {dt = -timestep;}      // If timeForward is false, we want dt to be negative
-            timeReversalStatus = "FALSE";
- */
-            // Check if time reversal should start
-            if (timeReversalActive && elapsedTimesteps == timeReversalTimestepInput) {
-                timeReversalTimestepInput = -timeReversalTimestepInput;
-                timeReversalInProgress = true;
-                nTimeReversalCalls = 0;
-                timeReversalStepCounter = nTimeReversalSteps;
-                if (timeForward){originalTimeStep = timestep;}
-                else{originalTimeStep = -1.0*timestep;}
-            }
-            
-            dt = timeForward ? timestep : -timestep;  // Continue with normal time progression
-            timeReversalStatus = "FALSE";
+        forceKernelAccuracy accuracy = fastExpForces ? forceKernelAccuracy::fast : forceKernelAccuracy::exact;
+        integratorMode mode = fusedIntegrator ? integratorMode::fusedVelocityVerlet : integratorMode::velocityVerlet;
+        if (integratorSchemeGui == 1) mode = integratorMode::forestRuth;
+        else if (integratorSchemeGui == 2) mode = integratorMode::pefrl;
+        else if (integratorSchemeGui == 3) mode = integratorMode::fixedPointVerlet;
+        ofVec2f boundary(ofGetWidth(), ofGetHeight());  // the window size is not safe to query off the main thread
+
+        // the 2nd order schemes keep their old 0.01 limit, only Forest-Ruth and PEFRL stay accurate up to 0.03
+        float maxTimestep = mode == integratorMode::forestRuth || mode == integratorMode::pefrl ? 0.03f : 0.01f;
+        if (timestep > maxTimestep) {
+            timestepInput = maxTimestep;    // onTimestepChanged copies it to timestep
+            timestep = maxTimestep;
         }
-        particleEnsemble.vv_propagatePositionsVelocities(attractorField.getAttractors(), dt);
-        
-        if (timeForward) {
-            elapsedTimesteps++;  // Increment elapsed timesteps
+
+        // steps from here on would not retrace the recorded ones, so the timeline starts again
+        bool inputsChanged = schedule.timestep != timestep || schedule.reversalActive != timeReversalActive
+            || schedule.reversalTimestep != timeReversalTimestepInput
+            || !sameAttractors(simulationAttractors, attractorField.getAttractors())
+            || particleEnsemble.forceAccuracy != accuracy || particleEnsemble.getIntegratorMode() != mode
+            || particleEnsemble.forceGridThreshold != forceGridThresholdGui
+            || particleEnsemble.forceGridTolerance != forceGridToleranceGui
+            || particleEnsemble.attractorCutoff != attractorCutoffGui
+            || particleEnsemble.getEditCount() != timelineEditCount || boundary != timelineBoundary;
+
+        schedule.timestep = timestep;
+        schedule.reversalActive = timeReversalActive;
+        schedule.reversalTimestep = timeReversalTimestepInput;
+        scheduledReversalTimestep = schedule.reversalTimestep;
+
+        simulationAttractors = attractorField.getAttractors();
+        particleEnsemble.forceAccuracy = accuracy;
+        particleEnsemble.setIntegratorMode(mode);
+        integratorSchemeDisplay = integratorModeName(mode);
+        particleEnsemble.forceGridThreshold = forceGridThresholdGui;
+        particleEnsemble.forceGridTolerance = forceGridToleranceGui;
+        particleEnsemble.attractorCutoff = attractorCutoffGui;
+        particleEnsemble.setBoundary(boundary.x, boundary.y);
+
+        timeline.setBudget(size_t(checkpointMemoryGui) << 20);
+        if (inputsChanged || (timeline.isEmpty() && timeline.getBudget() > 0)) {
+            restartTimeline();
+        }
+        if (timelineStepGui != shownTimelineStep) {
+            // the slider was dragged: pause, so the thread takes no step past the lock, and go there
+            isPlaying = false;
+            simulation.setPlaying(false);
+            seekTimeline(timelineStepGui);
+        }
+
+        if (!simulation.isRunning()) {
+            if (isPlaying) simulationStep();
         }
-        else {
-            elapsedTimesteps--;  // Decrement elapsed timesteps
+        else if (snapshotOutdated && !particleEnsemble.isSnapshotPending()) {
+            particleEnsemble.publishPositions();   // the last steps before a pause
+            snapshotOutdated = false;
         }
-        elapsedTimestepsDisplay = ofToString(elapsedTimesteps);  // Update GUI display
+
+        elapsedTimestepsDisplay = ofToString(schedule.elapsedTimesteps);  // Update GUI display
+        timeDirectionDisplay = schedule.timeForward ? "FORWARD" : "BACKWARD";
+        timeReversalStatus = schedule.timeReversalInProgress ? "TRUE" : "FALSE";
+
+        timelineStepGui.setMin(timeline.isEmpty() ? timelineStep : timeline.getOrigin());
+        timelineStepGui.setMax(timelineHead);
+        timelineStepGui = timelineStep;
+        shownTimelineStep = timelineStep;
+        timelineDisplay = ofToString(timeline.size()) + " (" + ofToString(timeline.bytesUsed() / double(1 << 20), 1) + " MB)";
+        recordingDisplay = recorder.isRecording() ? ofToString(recorder.getFramesWritten()) + " frames, "
+                               + ofToString(recorder.getBytesWritten() / double(1 << 20), 1) + " MB" : "off";
     }
     
+    // Replay: decoded frames go straight to the renderer
+    if (player.isOpen()) {
+        if (replayFrameGui != shownReplayFrame) {
+            player.seek(replayFrameGui);
+        }
+        player.setSpeed(replaySpeedGui);
+        player.advance(replayPaused ? 0.0f : float(ofGetLastFrameTime()));
+        if (player.fetch(replayPositions)) {
+            replayRenderer.update(replayPositions);
+        }
+        replayFrameGui.setMax(int(player.getFrameCount() - 1));
+        replayFrameGui = int(player.getFrame());
+        shownReplayFrame = replayFrameGui;
+        elapsedTimestepsDisplay = ofToString(player.getStep(player.getFrame()));
+        playPauseStatus = replayPaused ? "Replay paused" : "Replay";
+    }
+
     // Check and run the sequence if the toggle is active
     if (runSequenceToggle) {
+        auto timer = profiler.time(profilePhase::sequence);
         runSequence();
     }
+
+    simulation.setPlaying(isPlaying);
+}
+
+// One integrator step, on the simulation thread or, with the thread off, from update(). Runs under simulation.lockState().
+bool ofApp::simulationStep() {
+    if (simulationStepsLeft == 0) {
+        return false;
+    }
+    if (timelineStep < timelineHead) {
+        timeline.truncate(timelineStep);    // playing on from a scrubbed-to step replaces what came after it
+    }
+    advanceSimulation();
+    timelineHead = ++timelineStep;
+    if (timeline.wantsCheckpoint(timelineStep)) {
+        timeline.add(timelineStep, captureCheckpoint());
+    }
+    recorder.addStep(schedule.elapsedTimesteps, particleEnsemble.getPositions());
+    if (simulationStepsLeft > 0) {
+        --simulationStepsLeft;
+    }
+
+    // a snapshot the renderer has not picked up yet would be overwritten unseen, so skip the copy until it has
+    if (particleEnsemble.isSnapshotDrawing()) {
+        if (particleEnsemble.isSnapshotPending()) {
+            snapshotOutdated = true;
+        } else {
+            particleEnsemble.publishPositions();
+            snapshotOutdated = false;
+        }
+    }
+    return true;
+}
+
+void ofApp::advanceSimulation() {
+    float dt = schedule.nextTimestep();
+    particleEnsemble.vv_propagatePositionsVelocities(simulationAttractors, dt);
+    schedule.stepTaken();
+}
+
+checkpointStore::checkpoint ofApp::captureCheckpoint() const {
+    checkpointStore::checkpoint state;
+    particleEnsemble.saveState(state.particles);
+    state.schedule = schedule;
+    return state;
+}
+
+// The current step becomes the start of a new timeline. Runs under simulation.lockState().
+void ofApp::restartTimeline() {
+    timelineHead = timelineStep;
+    timelineEditCount = particleEnsemble.getEditCount();
+    timelineBoundary.set(particleEnsemble.getBoundaryWidth(), particleEnsemble.getBoundaryHeight());
+    if (timeline.getBudget() > 0) {
+        timeline.restart(timelineStep, captureCheckpoint());
+    } else {
+        timeline.clear();
+    }
+}
+
+// Brings the particles to a step of the timeline, replaying from the latest checkpoint before it, or from the current
+// step when that is on the way and closer. Runs under simulation.lockState().
+void ofApp::seekTimeline(long long step) {
+    step = std::max(timeline.getOrigin(), std::min(step, timelineHead));
+    long long from;
+    const checkpointStore::checkpoint* start = timeline.find(step, from);
+    if (start == nullptr || step == timelineStep) return;
+    if (step > timelineStep && timelineStep >= from) {
+        from = timelineStep;
+    } else {
+        particleEnsemble.restoreState(start->particles);
+        schedule = start->schedule;
+    }
+
+    // checkpoints halfway along the replay make the next step back cheap
+    timeline.dropReplaysAfter(step);
+    for (long long replayed = from + 1; replayed <= step; ++replayed) {
+        advanceSimulation();
+        if (checkpointStore::isBisectionStep(from, step, replayed)) {
+            timeline.addReplay(replayed, captureCheckpoint());
+        }
+    }
+    timelineStep = step;
+    if (particleEnsemble.isSnapshotDrawing()) {
+        particleEnsemble.publishPositions();
+        snapshotOutdated = false;
+    }
+}
+
+// Drags the particles along with an edit of the skeleton
+void ofApp::moveParticlesWithSkeleton() {
+    auto lock = simulation.lockState();
+    particleEnsemble.update(svgSkeleton.getEquidistantPoints());
+}
+
+void ofApp::exit() {
+    simulation.stop();
+    recorder.stop();
+    player.close();
 }
 
 void ofApp::draw() {
@@ -300,6 +525,7 @@ void ofApp::draw() {
     
     // Draw the potential field if the flag is set
     if (showPotentialField) {
+        auto timer = profiler.time(profilePhase::drawField);
         ofSetColor(potentialFieldColor->r, potentialFieldColor->g, potentialFieldColor->b); // Apply color
         potentialField.draw(0, 0, ofGetWidth(), ofGetHeight()); // Upscale when drawing
     }
@@ -310,6 +536,7 @@ void ofApp::draw() {
     
     // Draw contour lines if the flag is set
     if (showContourLines) {
+        auto timer = profiler.time(profilePhase::drawContours);
         ofSetColor(potentialFieldColor->r, potentialFieldColor->g, potentialFieldColor->b); // Apply color
         attractorField.drawContours();
     }
@@ -318,12 +545,25 @@ void ofApp::draw() {
     
     // unlike the particleEnsemble, the svgSkeleton points include the midpoint
     // we only draw the svgSkeleton points if explicitly indicated
-	if (vboParticles) {
-		particleEnsemble.drawVBO();
-	} else {
-		particleEnsemble.draw();
+	{
+		auto timer = profiler.time(profilePhase::drawParticles);
+		if (player.isOpen()) {
+			if (!replayPositions.empty()) {
+				ofPushStyle();
+				ofSetPointSize(5.0);
+				replayRenderer.draw();
+				ofPopStyle();
+			}
+		} else if (vboParticles) {
+			particleEnsemble.drawVBO();
+		} else {
+			particleEnsemble.draw();
+		}
 	}
-    if (showSvgPoints) {svgSkeleton.draw();}
+    if (showSvgPoints) {
+        auto timer = profiler.time(profilePhase::drawSkeleton);
+        svgSkeleton.draw();
+    }
     
     
     // Draw established attractors if the flag is set
@@ -339,13 +579,20 @@ void ofApp::draw() {
     }
     
     // Draw GUI
-    if(drawMenus){
-        gui.draw();
-        attractorGui.draw(); // Draw the attractor information panel
-        svgInfoGui.draw(); // Draw the SVG information panel
+    {
+        auto timer = profiler.time(profilePhase::drawGui);
+        if(drawMenus){
+            gui.draw();
+            attractorGui.draw(); // Draw the attractor information panel
+            svgInfoGui.draw(); // Draw the SVG information panel
+        }
+        if (drawFileMenu){
+            fileGui.draw();
+        }
     }
-    if (drawFileMenu){
-        fileGui.draw();
+
+    if (showProfiler) {
+        profiler.drawOverlay(ofGetWidth() - 620, ofGetHeight() - 220, 600, 200);
     }
 }
 
@@ -459,7 +706,7 @@ void ofApp::mouseDragged(int x, int y, int button) {
         }
 
         // Update the particle positions and SVG state
-        particleEnsemble.update(svgSkeleton.getEquidistantPoints());
+        moveParticlesWithSkeleton();
 
         // Update the initial angle for the next mouse move
         initialAngle = currentAngle;
@@ -523,14 +770,14 @@ void ofApp::mouseDragged(int x, int y, int button) {
                  if (minDistance < 10) {
                      ofPoint snappedOffset = nearestIntersection - svgSkeleton.getSvgCentroid();
                      svgSkeleton.translateSvg(snappedOffset);
-                     particleEnsemble.update(svgSkeleton.getEquidistantPoints());
+                     moveParticlesWithSkeleton();
                  } else {
                      svgSkeleton.translateSvg(offset);
-                     particleEnsemble.update(svgSkeleton.getEquidistantPoints());
+                     moveParticlesWithSkeleton();
                  }
              } else {
                  svgSkeleton.translateSvg(offset);
-                 particleEnsemble.update(svgSkeleton.getEquidistantPoints());
+                 moveParticlesWithSkeleton();
              }
 
              svgSkeleton.calculateSvgMidpoint();
@@ -565,7 +812,7 @@ void ofApp::mouseDragged(int x, int y, int button) {
         if (mousePos.x > 0 && mousePos.x < ofGetWidth() && mousePos.y > 0 && mousePos.y < ofGetHeight()){
             svgSkeleton.resizeSvg(scaleFactor,false);
             svgScale = svgSkeleton.getCumulativeScale(); // Update the cumulative scale in the GUI
-            particleEnsemble.update(svgSkeleton.getEquidistantPoints());
+            moveParticlesWithSkeleton();
             initialMousePos.set(x, y);
         }
      }
@@ -585,6 +832,7 @@ void ofApp::mouseReleased(int x, int y, int button) {
     translatingSvg = false;
     resizingSvg = false;
     selectedAttractorIndex = -1;
+    attractorField.invalidatePotentialField(); // rebuild once the drag is over, dropping the rounding left by incremental updates
     potentialFieldUpdated = true;
     contourLinesUpdated = true; // Mark contour lines for update
     if (rotatingSvg) {
@@ -596,8 +844,8 @@ void ofApp::updateContours() {
     int width = ofGetWidth() / downscaleFactor;
     int height = ofGetHeight() / downscaleFactor;
     float contourThreshold = contourThresholdSlider;  // Use the slider value
+    calculatePotentialField();  // the contours are traced on the potential grid, so bring it up to date first
     attractorField.updateContours(downscaleFactor, width, height, svgSkeleton.getEquidistantPoints(), contourThreshold);
-    calculatePotentialField();
 }
 
 void ofApp::calculatePotentialField(){
@@ -617,6 +865,7 @@ void ofApp::windowResized(int w, int h) {
     int height = h / downscaleFactor;
     regenerateGridIntersections();  // Regenerate grid intersections when the window is resized
     potentialField.allocate(width, height, OF_IMAGE_GRAYSCALE); // Reallocate the potential field image
+    attractorField.invalidatePotentialField(); // the new image has no pixels to patch
     potentialFieldUpdated = true; // Mark the potential field as needing an update
     contourLinesUpdated = true; // Mark contour lines for update
     attractorGui.setPosition(ofGetWidth() - 210, gui.getPosition().y); // Position to the right of the main panel
@@ -628,7 +877,10 @@ void ofApp::keyPressed(int key) {
         showPotentialField = !showPotentialField; // Toggle the flag
         showPotentialFieldGui = showPotentialField; // Sync the GUI checkbox
     }
-    if (key == ' ') {
+    if (key == ' ' && player.isOpen()) {
+        replayPaused = !replayPaused;
+    }
+    else if (key == ' ') {
         isPlaying = !isPlaying;
         playPauseStatus = isPlaying ? "Play" : "Pause";  // Update play/pause status
         if (isPlaying) {
@@ -636,13 +888,9 @@ void ofApp::keyPressed(int key) {
         }
     }
     if (key == 'b' || key == 'B') {
-        if(!timeReversalInProgress){  // only take action if there's not already a time reversal in progress
-            timeReversalInProgress = true;
-            nTimeReversalCalls = 0;
-            timeReversalStepCounter = nTimeReversalSteps;
-            if (timeForward){originalTimeStep = timestep;}
-            else{originalTimeStep = -1.0*timestep;}
-        }
+        auto lock = simulation.lockState();
+        schedule.startReversal();  // only takes action if there's not already a time reversal in progress
+        restartTimeline();
     }
     if (key == 'r' || key == 'R') {
         resetSimulation();
@@ -661,6 +909,7 @@ void ofApp::keyPressed(int key) {
         if(!showGrid){enableSnapping = false;}
     }
     if (key == 'w' || key == 'W') {
+        auto lock = simulation.lockState();
         svgSkeleton.writeSvg(particleEnsemble.getPositions());   // Assuming svgSkeleton is an instance of your svgSkeleton class
     }
     if (key == 'm' || key == 'M') {
@@ -669,6 +918,38 @@ void ofApp::keyPressed(int key) {
     if(key == 'f' || key == 'F'){
         drawFileMenu = !drawFileMenu;
     }
+    if (key == 'o' || key == 'O') {
+        showProfiler = !showProfiler;   // frame time overlay
+    }
+    if (key == 'e' || key == 'E') {
+        profiler.writeCsv("profile_" + ofGetTimestampString("%Y-%m-%d_%H-%M-%S") + ".csv");
+    }
+    if (key == 'v' || key == 'V') {
+        auto lock = simulation.lockState();
+        if (recorder.isRecording()) {
+            recorder.stop();
+            ofLogNotice() << "Trajectory recording stopped after " << recorder.getFramesWritten() << " frames";
+        } else {
+            std::string filename = "trajectory_" + ofGetTimestampString("%Y-%m-%d_%H-%M-%S") + "." + trajectoryRecorder::extension();
+            if (recorder.start(ofToDataPath(filename), particleEnsemble.getPositions().size(), recordPrecisionGui, recordIntervalGui)) {
+                ofLogNotice() << "Recording trajectory to " << filename;
+            } else {
+                ofLogError() << "Unable to open file for writing: " << filename;
+            }
+        }
+    }
+    if ((key == 'x' || key == 'X') && player.isOpen()) {
+        closeReplay();
+    }
+    if (key == 'k' || key == 'K') {
+        saveSnapshot("snapshot_" + ofGetTimestampString("%Y-%m-%d_%H-%M-%S") + "." + simulationSnapshot::extension());
+    }
+    if (key == 'd' || key == 'D') {
+        saveCompiledSkeleton(ofFilePath::removeExt(svgFileName.get()) + "_" + ofToString(numPoints) + "." + compiledSkeleton::extension());
+    }
+    if ((key == 't' || key == 'T') && !traceRecorder::isRecording()) {
+        traceRecorder::startCapture(traceFramesGui);    // written to trace_<timestamp>.json when done
+    }
 }
 
 void ofApp::addAttractorGui(const attractor& attractor) {
@@ -760,14 +1041,18 @@ void ofApp::resetSimulation() {
     playPauseStatus = "Pause";  // Update play/pause status
     showSvgPoints = true;  // Show SVG points when resetting
 
+    auto lock = simulation.lockState();
+
     // Reset particle positions to original positions along the SVG skeleton
     particleEnsemble.reinitialize(svgSkeleton.getEquidistantPoints());
-
-    // Reset elapsed timesteps
-    elapsedTimesteps = 0;
-    elapsedTimestepsDisplay = ofToString(elapsedTimesteps);  // Update GUI display
-    timeReversalInProgress = false;
-    timeForward = true; // Reset to forward direction
+    snapshotOutdated = false;
+    simulationStepsLeft = -1;
+
+    // Reset elapsed timesteps and go forward again
+    schedule.reset();
+    elapsedTimestepsDisplay = ofToString(schedule.elapsedTimesteps);  // Update GUI display
+    timelineStep = 0;
+    restartTimeline();
 }
 
 void ofApp::drawGrid() {
@@ -948,38 +1233,6 @@ ofPoint ofApp::getNearestRectangularGridIntersection(const ofPoint& point, float
 }
 */
 
-float ofApp::gentlyReverseTimeWithCos() {
-    float new_timeStep, stepSize;
-    
-    ++nTimeReversalCalls;
-    
-    stepSize = 2 * PI / (2 * nTimeReversalSteps + 1);
-    
-    if (timeReversalStepCounter > 0) {       // slowly reduce the size of the timestep
-        new_timeStep = originalTimeStep * 0.5 * (cos(nTimeReversalCalls * stepSize) + 1);
-    } else if (timeReversalStepCounter == 0) {   // flip the sign
-        new_timeStep = -1.0 * last_timeStep;
-        originalTimeStep *= -1;
-        timeForward = !timeForward;
-        timeDirectionDisplay = timeForward ? "FORWARD" : "BACKWARD";
-    } else if (timeReversalStepCounter < 0) {   // slowly increase the size of the timestep
-        new_timeStep = originalTimeStep * 0.5 * (cos(nTimeReversalCalls * stepSize) + 1);
-    }
-    
-    timeReversalStepCounter -= 1;
-
-    if (timeReversalStepCounter < (-1 * nTimeReversalSteps)) {
-        timeReversalInProgress = false;
-        timeReversalStatus = "FALSE";  // Update the status
-    }
-    else {
-        timeReversalStatus = "TRUE";  // Update the status
-    }
-    
-    last_timeStep = new_timeStep;
-    return new_timeStep;
-}
-
 // write particle positions as points along polyline
 void ofApp::writeParticlePositionsToSvg() {
     if (!isPlaying) {  // Only write if the simulation is paused
@@ -999,9 +1252,11 @@ void ofApp::writeParticlePositionsToSvg() {
 
             // Write particle positions as a polyline
             svgFile << "<polyline points=\"";
-            for (const auto& position : particleEnsemble.getPositions()) {
-                svgFile << position.x << "," << position.y << " ";
-                ofLogNotice() << "Writing position: " << position.x << ", " << position.y;
+            auto lock = simulation.lockState();
+            const particleStreams& positions = particleEnsemble.getPositions();
+            for (size_t i = 0; i < positions.size(); ++i) {
+                svgFile << positions.x[i] << "," << positions.y[i] << " ";
+                ofLogNotice() << "Writing position: " << positions.x[i] << ", " << positions.y[i];
             }
             svgFile << "\" fill=\"none\" stroke=\"black\" stroke-width=\"1\" />\n";
 
@@ -1021,6 +1276,7 @@ void ofApp::onFlipPotentialFieldRenderChanged(bool & state) {
 }
 
 void ofApp::onTimeReversalTimestepInputUpdated(int & value){
+    int nTimeReversalSteps = schedule.nTimeReversalSteps;
     if (timeReversalTimestepInput >= 0 && timeReversalTimestepInput <= nTimeReversalSteps){
         timeReversalTimestep = nTimeReversalSteps + 1;
         timeReversalTimestepInput = timeReversalTimestep;
@@ -1037,11 +1293,20 @@ void ofApp::onTimeReversalTimestepInputUpdated(int & value){
 }
 
 void ofApp::saveSettings() {
+    traceRecorder::scope trace("saveSettings");
     
     std::string baseFilename = saveFileNameInput;
     if (baseFilename.empty()) {
         baseFilename = "settings.xml";
     }
+    if (ofFilePath::getFileExt(baseFilename) == simulationSnapshot::extension()) {
+        saveSnapshot(baseFilename);
+        return;
+    }
+    if (compiledSkeleton::isCompiledSkeleton(baseFilename)) {
+        saveCompiledSkeleton(baseFilename);
+        return;
+    }
 
     // Separate the base filename and the extension
     std::string extension = ".xml";
@@ -1100,6 +1365,7 @@ void ofApp::saveSettings() {
 }
 
 void ofApp::loadSettings(const std::string& filename) {
+    traceRecorder::scope trace("loadSettings");
     // Load the XML file
     
     float scaleForCurrentGraphicsWindow;
@@ -1137,6 +1403,7 @@ void ofApp::loadSettings(const std::string& filename) {
         // Load the SVG info GUI
         ofXml svgInfoXml = settings.getChild("svgInfoGui");
         if (svgInfoXml && originalWindowSize.x > 0 && originalWindowSize.y > 0) {
+            auto lock = simulation.lockState();    // the skeleton edits below move the particles step by step
             svgInfoGui.loadFrom(svgInfoXml);
 
             // Load svgFile_
@@ -1280,7 +1547,140 @@ void ofApp::loadSettings(const std::string& filename) {
 
 void ofApp::onLoadSettingsButtonPressed() {
     std::string filename = loadFileNameInput; // Alternative way to get the filename
-    loadSettings(filename); // Load settings from the specified file
+    if (ofFilePath::getFileExt(filename) == simulationSnapshot::extension()) {
+        loadSnapshot(filename);
+    } else if (ofFilePath::getFileExt(filename) == trajectoryRecorder::extension()) {
+        openReplay(filename);
+    } else {
+        loadSettings(filename); // Load settings from the specified file
+    }
+}
+
+void ofApp::openReplay(const std::string& filename) {
+    if (!player.open(ofToDataPath(filename))) {
+        ofLogError() << "Failed to open trajectory " << filename;
+        return;
+    }
+    isPlaying = false;      // the integrator stays where it was until the replay is closed
+    replayPaused = false;
+    replayPositions.resize(0);
+    shownReplayFrame = 0;
+    replayFrameGui.setMax(int(player.getFrameCount() - 1));
+    replayFrameGui = 0;
+    showSvgPoints = false;
+    ofLogNotice() << "Replaying " << filename << ": " << player.getFrameCount() << " frames of "
+                  << player.getParticleCount() << " particles, every " << player.getStepInterval() << " steps";
+}
+
+void ofApp::closeReplay() {
+    player.close();
+    replayPositions.resize(0);
+    replayFrameGui.setMax(0);
+    replayFrameGui = 0;
+    shownReplayFrame = 0;
+    playPauseStatus = isPlaying ? "Play" : "Pause";
+}
+
+void ofApp::saveSnapshot(const std::string& filename) {
+    traceRecorder::scope trace("saveSnapshot");
+    simulationSnapshot snapshot;
+    {
+        auto lock = simulation.lockState();
+        particleEnsemble.saveState(snapshot.particles);
+        snapshot.schedule = schedule;
+        snapshot.boundaryWidth = particleEnsemble.getBoundaryWidth();
+        snapshot.boundaryHeight = particleEnsemble.getBoundaryHeight();
+        snapshot.forceAccuracy = particleEnsemble.forceAccuracy;
+        snapshot.forceGridThreshold = particleEnsemble.forceGridThreshold;
+        snapshot.forceGridTolerance = particleEnsemble.forceGridTolerance;
+        snapshot.attractorCutoff = particleEnsemble.attractorCutoff;
+    }
+    snapshot.attractors = attractorField.getAttractors();
+    svgSkeleton.saveState(snapshot.skeleton);
+
+    if (snapshot.save(ofToDataPath(filename))) {
+        ofLogNotice() << "Snapshot saved to " << filename;
+    } else {
+        ofLogError() << "Unable to open file for writing: " << filename;
+    }
+}
+
+void ofApp::saveCompiledSkeleton(const std::string& filename) {
+    traceRecorder::scope trace("saveCompiledSkeleton");
+    if (svgSkeleton.saveCompiled(filename)) {
+        ofLogNotice() << "Skeleton compiled to " << filename;
+    } else {
+        ofLogError() << "Unable to open file for writing: " << filename;
+    }
+}
+
+// Picks up where the snapshot left off, paused; the SVG is only read again if the points are regenerated
+void ofApp::loadSnapshot(const std::string& filename) {
+    traceRecorder::scope trace("loadSnapshot");
+    simulationSnapshot snapshot;
+    if (!snapshot.load(ofToDataPath(filename))) {
+        ofLogError() << "Failed to load snapshot from " << filename;
+        return;
+    }
+    isPlaying = false;
+    playPauseStatus = "Pause";
+
+    // attractors and their GUI, as in loadSettings
+    for (int i = attractorField.getAttractors().size() - 1; i >= 0; --i) {
+        attractorField.removeAttractorAt(i);
+        removeAttractorGui(i);
+    }
+    attractorCenters.clear();
+    attractorRadiusInputs.clear();
+    attractorAmplitudeInputs.clear();
+    attractorGui.clear();
+    for (const auto& snapshotAttractor : snapshot.attractors) {
+        attractorField.addAttractor(snapshotAttractor);
+        addAttractorGui(snapshotAttractor);
+    }
+    potentialFieldUpdated = true;
+    contourLinesUpdated = true;
+
+    svgSkeleton.restoreState(snapshot.skeleton);
+    svgFileName = snapshot.skeleton.fileName;
+    numPoints = snapshot.skeleton.requestedPoints;
+    numPointsInput = numPoints;     // so update() does not resample
+
+    // the settings the run was stepped with
+    timestep = snapshot.schedule.timestep;
+    timestepInput = timestep;
+    timeReversalActive = snapshot.schedule.reversalActive;
+    timeReversalTimestepInput = snapshot.schedule.reversalTimestep;
+    integratorMode mode = snapshot.particles.integrator;
+    fusedIntegrator = mode != integratorMode::velocityVerlet;
+    integratorSchemeGui = mode == integratorMode::forestRuth ? 1 : mode == integratorMode::pefrl ? 2
+                        : mode == integratorMode::fixedPointVerlet ? 3 : 0;
+    if (snapshot.hasForceSettings) {
+        fastExpForces = snapshot.forceAccuracy == forceKernelAccuracy::fast;
+        forceGridThresholdGui = snapshot.forceGridThreshold;
+        forceGridToleranceGui = snapshot.forceGridTolerance;
+        attractorCutoffGui = snapshot.attractorCutoff;
+    }
+    if (snapshot.boundaryWidth != ofGetWidth() || snapshot.boundaryHeight != ofGetHeight()) {
+        ofLogNotice() << "Snapshot was taken in a " << snapshot.boundaryWidth << "x" << snapshot.boundaryHeight << " window";
+    }
+
+    auto lock = simulation.lockState();
+    particleEnsemble.restoreState(snapshot.particles);
+    if (snapshot.hasForceSettings) {
+        particleEnsemble.forceAccuracy = snapshot.forceAccuracy;
+        particleEnsemble.forceGridThreshold = snapshot.forceGridThreshold;
+        particleEnsemble.forceGridTolerance = snapshot.forceGridTolerance;
+        particleEnsemble.attractorCutoff = snapshot.attractorCutoff;
+    }
+    schedule = snapshot.schedule;
+    scheduledReversalTimestep = schedule.reversalTimestep;
+    snapshotOutdated = false;
+    simulationStepsLeft = -1;
+    timelineStep = 0;
+    restartTimeline();
+    ofLogNotice() << "Snapshot loaded from " << filename << " (" << particleEnsemble.getPositions().size()
+                  << " particles, step " << schedule.elapsedTimesteps << ")";
 }
 
 void ofApp::onPasteLoadFilenameButtonPressed() {
@@ -1337,12 +1737,13 @@ void ofApp::runSequence() {
     // Load the next file if duration for the current file is complete
     if (numStepsSequenceFileRun==0 && sequenceFileNeedsLoading) {
         const std::string& filename = sequenceFiles[currentSequenceIndex];
+        traceRecorder::instant("sequence load " + ofFilePath::getFileName(filename));
         loadSettings(filename);
         resetSimulation();
         sequenceFileNeedsLoading = false;
         timeReversalActive = true;                // set time Reversal to active
         callsToRunSequence = 0;
-        sequenceDuration = 2 * (timeReversalTimestep + nTimeReversalSteps);
+        sequenceDuration = schedule.sequenceLength(timeReversalTimestep);
         ++currentSequenceIndex;                   // Move to the next file
     }
     else if (!isIndividualFileRunning && callsToRunSequence < nPauseSteps && !isFileFinishedRunning){
@@ -1350,20 +1751,29 @@ void ofApp::runSequence() {
         ++callsToRunSequence;
     }
     else if (callsToRunSequence == nPauseSteps && !isFileFinishedRunning){
+        traceRecorder::instant("sequence play");
+        {
+            auto lock = simulation.lockState();
+            simulationStepsLeft = sequenceDuration;   // the integrator pauses itself after exactly this many steps
+        }
         isPlaying = true;
         showSvgPoints = false;
         isIndividualFileRunning = true;
         callsToRunSequence = 0;
     }
     else if (isIndividualFileRunning && numStepsSequenceFileRun < sequenceDuration && !isFileFinishedRunning){
-        if (isPlaying){  // increment the step counter if we're not paused
-//            cout << numStepsSequenceFileRun << " playPauseStatus " << playPauseStatus << endl;
-            ++numStepsSequenceFileRun;
-        }
+        // count the steps actually taken, however many the integrator fits into a frame
+        auto lock = simulation.lockState();
+        numStepsSequenceFileRun = sequenceDuration - simulationStepsLeft;
     }
     else if (numStepsSequenceFileRun == sequenceDuration && !isFileFinishedRunning){
+        traceRecorder::instant("sequence finished");
         isFileFinishedRunning = true;
         isPlaying = false;
+        {
+            auto lock = simulation.lockState();
+            simulationStepsLeft = -1;
+        }
         showSvgPoints = true;
         isIndividualFileRunning = false;
         callsToRunSequence = 0;
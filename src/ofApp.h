@@ -7,6 +7,13 @@
 #include "attractorField.h"
 #include "particleEnsemble.h"
 #include "svgSkeleton.h"
+#include "frameProfiler.h"
+#include "timeReversalSchedule.h"
+#include "simulationThread.h"
+#include "checkpointStore.h"
+#include "simulationSnapshot.h"
+#include "trajectoryRecorder.h"
+#include "trajectoryPlayer.h"
 #include <fstream>
 #include <ctime>
 #include <iomanip>
@@ -16,6 +23,7 @@ public:
     void setup();
     void update();
     void draw();
+    void exit();
 
     void mousePressed(int x, int y, int button);
     void mouseDragged(int x, int y, int button);
@@ -67,10 +75,7 @@ private:
     int numPoints;
     
     ofParameter<string> elapsedTimestepsDisplay;  // New parameter for elapsed timesteps
-    long long elapsedTimesteps;  // Counter for elapsed timesteps
-    
     ofParameter<string> timeDirectionDisplay;  // New parameter for time direction
-    bool timeForward;  // Flag to track the direction of time
     
     // GUI
     ofxPanel gui;
@@ -136,6 +141,20 @@ private:
     void resetSimulation();
 
 	ofParameter<bool> vboParticles;
+    ofParameter<bool> fastExpForces;            // use the polynomial exp in the force kernel
+    ofParameter<string> forceKernelDisplay;     // instruction set the force kernel runs on
+    ofParameter<int> simulationThreadsGui;      // threads used for the integrator step
+    ofParameter<bool> fusedIntegrator;          // single-pass velocity Verlet without the last_f/last_positions copies
+    ofParameter<int> integratorSchemeGui;       // 0 = velocity Verlet, 1 = Forest-Ruth, 2 = PEFRL (4th order, larger steps),
+                                                // 3 = fixed-point Verlet (bit-exact time reversal)
+    ofParameter<string> integratorSchemeDisplay;
+    ofParameter<int> forceGridThresholdGui;     // attractor count from which forces come from the tabulated field
+    ofParameter<float> forceGridToleranceGui;   // error bound of the tabulated field (forceGrid::update)
+    ofParameter<float> attractorCutoffGui;      // attractors beyond this many sigma are skipped, 0 = off
+
+    frameProfiler profiler;     // per-phase frame times, 'o' shows them, 'e' writes percentiles to CSV
+    bool showProfiler = false;
+    ofParameter<int> traceFramesGui;    // frames a trace capture ('t') records, see traceRecorder.h
 
     std::vector<ofPoint> gridIntersections;  // Store the grid intersection points
     ofParameter<bool> showGrid; // Declare showGrid as private
@@ -148,16 +167,8 @@ private:
     // New helper function to find the nearest vertex on the grid
     ofPoint getNearestGridIntersection(const ofPoint& point, float& minDistance);
     
-    // Time reversal variables
-    bool timeReversalInProgress;
-    int nTimeReversalSteps; // Adjust this value as needed
-    int timeReversalStepCounter;
-    int nTimeReversalCalls;
-    float last_timeStep;
-    float originalTimeStep;
-    
-    // Function declaration
-    float gentlyReverseTimeWithCos();
+    // Timestep schedule: elapsed steps, time direction and the time reversal ramp
+    timeReversalSchedule schedule;
     ofParameter<string> timeReversalStatus;  // Add this for displaying time reversal status
     
     ofParameter<bool> enableSnapping;
@@ -189,6 +200,14 @@ private:
     void saveSettings();
     void loadSettings(const std::string& filename);
 
+    // Whole simulation state as a binary .dysnap (see simulationSnapshot.h): 'k', or a .dysnap name in the file menu
+    void saveSnapshot(const std::string& filename);
+    void loadSnapshot(const std::string& filename);
+
+    // The skeleton points as a precompiled .dyskel (see compiledSkeleton.h): 'd', or a .dyskel name in the file menu.
+    // Loaded wherever an SVG file name goes.
+    void saveCompiledSkeleton(const std::string& filename);
+
     void onLoadSettingsButtonPressed();
     
     ofxButton buttonToPasteLoadFilenameFromClipboard;
@@ -212,5 +231,52 @@ private:
     
     void loadSequenceFiles();
     void runSequence();
-    
+
+    // Integrator thread. Everything a step touches (particleEnsemble, schedule, the members below) is only
+    // used under simulation.lockState(); update() hands the GUI state over once per frame.
+    bool simulationStep();
+    void moveParticlesWithSkeleton();
+    std::vector<attractor> simulationAttractors;    // attractorField as of the last update(), what the steps integrate
+    int simulationStepsLeft = -1;                   // steps until the integrator pauses itself (runSequence), -1 = no limit
+    bool snapshotOutdated = false;                  // steps were taken while the last snapshot still waited to be drawn
+    int scheduledReversalTimestep;                  // reversal step last handed to the schedule, to spot the flip
+    ofParameter<bool> simulationThreadGui;          // integrate on simulationThread instead of once per update()
+    ofParameter<int> simulationRateGui;             // steps per second on the thread, 0 = as fast as possible
+
+    // Timeline of the run for scrubbing back and forth, also under simulation.lockState(). Steps count from the
+    // last reset; a change to anything the steps depend on starts the timeline again from the current step.
+    checkpointStore::checkpoint captureCheckpoint() const;
+    void restartTimeline();
+    void seekTimeline(long long step);
+    void advanceSimulation();                       // one step of the schedule, without the bookkeeping of simulationStep
+    checkpointStore timeline;
+    long long timelineStep = 0;                     // step the particles are at
+    long long timelineHead = 0;                     // last step of the timeline; scrubbing back and playing drops the rest
+    long long timelineEditCount = -1;               // particleEnsemble edits the timeline started after
+    ofVec2f timelineBoundary;                       // box the timeline was integrated in
+    long long shownTimelineStep = 0;                // what the slider showed last frame, to spot a drag
+    ofParameter<int> timelineStepGui;               // scrub slider
+    ofParameter<int> checkpointMemoryGui;           // MB for checkpoints, 0 = no scrubbing
+    ofParameter<string> timelineDisplay;
+
+    // Trajectory recording ('v'), fed by simulationStep (see trajectoryRecorder.h)
+    trajectoryRecorder recorder;
+    ofParameter<int> recordIntervalGui;             // steps per recorded frame
+    ofParameter<float> recordPrecisionGui;          // pixels per quantization step
+    ofParameter<string> recordingDisplay;
+
+    // Replay of a recorded trajectory (a .dytraj name in the file menu, 'x' leaves it): the frames are drawn
+    // instead of the particles and nothing is integrated. Space pauses it.
+    void openReplay(const std::string& filename);
+    void closeReplay();
+    trajectoryPlayer player;
+    particleRenderer replayRenderer;
+    particleStreams replayPositions;
+    bool replayPaused = false;
+    long long shownReplayFrame = 0;
+    ofParameter<float> replaySpeedGui;              // recorded frames per second, negative plays backwards
+    ofParameter<int> replayFrameGui;                // seek slider
+
+    ofParameter<int> skeletonCacheGui;              // MB for parsed SVGs and point sets (see skeletonCache.h)
+    simulationThread simulation;                    // last member, so it stops before the state it steps goes away
 };
@@ -1,5 +1,6 @@
 #include "particleEnsemble.h"
 #include "attractor.h"  // Include the attractor class
+#include "traceRecorder.h"
 
 particleEnsemble::particleEnsemble() {
     // Default constructor
@@ -9,43 +10,120 @@ void particleEnsemble::initialize(const std::vector<glm::vec3>& initialPositions
 	ofDisableArbTex();
 
     // Exclude the first element (midpoint) and copy the rest of the positions
-    positions.assign(initialPositions.begin() + 1, initialPositions.end());
-    last_positions.assign(initialPositions.begin() + 1, initialPositions.end());
+    positions.assign(initialPositions, 1);
+    if (integrator == integratorMode::velocityVerlet) {
+        last_positions.assign(initialPositions, 1);
+        last_f.resize(positions.size(), 0.0f);
+    }
     
-    v.resize(positions.size(), glm::vec3(0, 0, 0));
-    f.resize(positions.size(), glm::vec3(0, 0, 0));
-    last_f.resize(positions.size(), glm::vec3(0, 0, 0));
+    v.resize(positions.size(), 0.0f);
+    f.resize(positions.size(), 0.0f);
     radii.resize(positions.size(), 1.0f); // Example radius initialization
     masses.resize(positions.size(), 1.0f); // Example mass initialization
-
-    // allocate memory for particle data
-	positions.reserve(initialPositions.size());
-
-	vboRenderer.load();
+    latticeSynced = false;
+    ++editCount;
+    if (snapshotDrawing) publishPositions();
 }
 
 void particleEnsemble::reinitialize(const std::vector<glm::vec3>& initialPositions) {
     // Exclude the first element (midpoint) and copy the rest of the positions
-    positions.assign(initialPositions.begin() + 1, initialPositions.end());
-    last_positions.assign(initialPositions.begin() + 1, initialPositions.end());
+    positions.assign(initialPositions, 1);
+    if (integrator == integratorMode::velocityVerlet) {
+        last_positions.assign(initialPositions, 1);
+        last_f.fill(0.0f);
+    }
 
-    std::fill(v.begin(), v.end(), glm::vec3(0, 0, 0));
-    std::fill(f.begin(), f.end(), glm::vec3(0, 0, 0));
-    std::fill(last_f.begin(), last_f.end(), glm::vec3(0, 0, 0));
+    v.fill(0.0f);
+    f.fill(0.0f);
+    latticeSynced = false;
+    ++editCount;
+    if (snapshotDrawing) publishPositions();
 }
 
 void particleEnsemble::update(const std::vector<glm::vec3>& initialPositions) {
     // Exclude the first element (midpoint) and copy the rest of the positions
-    positions.assign(initialPositions.begin() + 1, initialPositions.end());
-    last_positions.assign(initialPositions.begin() + 1, initialPositions.end());
+    positions.assign(initialPositions, 1);
+    if (integrator == integratorMode::velocityVerlet) {
+        last_positions.assign(initialPositions, 1);
+    }
+    latticeSynced = false;
+    ++editCount;
+    if (snapshotDrawing) publishPositions();
+}
+
+void particleEnsemble::saveState(particleState& state) const {
+    state.integrator = integrator;
+    state.positions = positions;
+    state.v = v;
+    state.f = f;
+    state.last_positions = last_positions;
+    state.last_f = last_f;
+    state.latticeX = latticeX;
+    state.latticeY = latticeY;
+    state.latticeVx = latticeVx;
+    state.latticeVy = latticeVy;
+    state.latticeSynced = latticeSynced;
+    state.latticeForcesValid = latticeForcesValid;
+    state.forcesValid = forcesValid;
+}
+
+void particleEnsemble::restoreState(const particleState& state) {
+    integrator = state.integrator;
+    positions = state.positions;
+    v = state.v;
+    f = state.f;
+    last_positions = state.last_positions;
+    last_f = state.last_f;
+    latticeX = state.latticeX;
+    latticeY = state.latticeY;
+    latticeVx = state.latticeVx;
+    latticeVy = state.latticeVy;
+    latticeSynced = state.latticeSynced;
+    latticeForcesValid = state.latticeForcesValid;
+    forcesValid = state.forcesValid;
+    radii.resize(positions.size(), 1.0f);
+    masses.resize(positions.size(), 1.0f);
+    if (snapshotDrawing) publishPositions();
+}
+
+size_t particleState::bytes() const {
+#ifdef DYANTRA_PARTICLE_Z
+    const size_t components = 3;
+#else
+    const size_t components = 2;
+#endif
+    size_t vectors = positions.size() + v.size() + f.size() + last_positions.size() + last_f.size();
+    size_t ints = latticeX.size() + latticeY.size() + latticeVx.size() + latticeVy.size();
+    return vectors * components * sizeof(float) + ints * sizeof(int32_t);
+}
+
+void particleEnsemble::setSnapshotDrawing(bool enabled) {
+    snapshotDrawing = enabled;
+    if (snapshotDrawing) publishPositions();
+}
+
+void particleEnsemble::publishPositions() {
+    positionSnapshots.writeBuffer() = positions;   // same size after the first few publishes, so no allocation
+    positionSnapshots.publish();
+}
+
+const particleStreams& particleEnsemble::drawnPositions() const {
+    if (!snapshotDrawing) return positions;
+    positionSnapshots.acquire();
+    return positionSnapshots.readBuffer();
 }
 
 void particleEnsemble::draw() const {
 	ofSetCircleResolution(5);
 	ofPushMatrix();
     ofFill();
+    const particleStreams& positions = drawnPositions();
     for (size_t i = 0; i < positions.size(); ++i) {
-        ofDrawCircle(positions[i], radii[i]);
+#ifdef DYANTRA_PARTICLE_Z
+        ofDrawCircle(positions.x[i], positions.y[i], positions.z[i], radii[i]);
+#else
+        ofDrawCircle(positions.x[i], positions.y[i], radii[i]);
+#endif
 		//ofdraw
     }
 	ofPopMatrix();
@@ -55,18 +133,18 @@ void particleEnsemble::draw() const {
 void particleEnsemble::drawVBO() {
 	ofPushStyle();
 	ofSetPointSize(5.0);
-	vboRenderer.update(positions);
+	vboRenderer.update(drawnPositions());
 	vboRenderer.draw();
 	ofPopStyle();
 }
 
 void particleEnsemble::radial_update(float dt, float angularVelocity, const glm::vec3& midpoint) {
-    for (auto& pos : positions) {
+    for (size_t i = 0; i < positions.size(); ++i) {
         float angle = angularVelocity * dt;
-        float newX = cos(angle) * (pos.x - midpoint.x) - sin(angle) * (pos.y - midpoint.y) + midpoint.x;
-        float newY = sin(angle) * (pos.x - midpoint.x) + cos(angle) * (pos.y - midpoint.y) + midpoint.y;
-        pos.x = newX;
-        pos.y = newY;
+        float newX = cos(angle) * (positions.x[i] - midpoint.x) - sin(angle) * (positions.y[i] - midpoint.y) + midpoint.x;
+        float newY = sin(angle) * (positions.x[i] - midpoint.x) + cos(angle) * (positions.y[i] - midpoint.y) + midpoint.y;
+        positions.x[i] = newX;
+        positions.y[i] = newY;
     }
 }
 
@@ -165,71 +243,482 @@ void particleEnsemble::vv_propagatePositionsVelocities(vector <attractor> attrac
 */
 
 void particleEnsemble::vv_propagatePositionsVelocities(const std::vector<attractor>& attractorVec, float dt) {
-    float factor;
+    traceRecorder::scope trace("integrator step");
     float mass = 1.0f;  // Assuming mass is 1.0f for all particles
+    const size_t n = positions.size();
+
+    // Everything the workers need from openFrameworks is read here, on the main thread
+    stepConstants step;
+    step.dt = dt;
+    step.boxWidth = boundaryWidth > 0 ? boundaryWidth : ofGetWidth();
+    step.boxHeight = boundaryHeight > 0 ? boundaryHeight : ofGetHeight();
+    step.driftFactor = 0.5 * dt * dt / mass;
+    step.kickFactor = dt * 0.5 / mass;
+
+    // Pack the attractor parameters once for the force kernel
+    wells.resize(attractorVec.size());
+    for (size_t k = 0; k < attractorVec.size(); ++k) {
+        const ofPoint& center = attractorVec[k].getCenter();
+        wells[k].cx = center.x;
+        wells[k].cy = center.y;
+#ifdef DYANTRA_PARTICLE_Z
+        wells[k].cz = center.z;
+#endif
+        wells[k].coefficient = attractorVec[k].get_coefficient();
+        wells[k].expDenominator = attractorVec[k].get_exp_denominator();
+    }
+
+    // Dense attractor fields switch to the tabulated field; it is only rebuilt when the attractors or the window change
+#ifdef DYANTRA_PARTICLE_Z
+    useForceGrid = false;   // the grid is planar
+#else
+    useForceGrid = forceGridThreshold > 0 && int(wells.size()) >= forceGridThreshold;
+#endif
+    if (useForceGrid) {
+        fieldGrid.update(wells, step.boxWidth, step.boxHeight, forceGridTolerance);
+        useForceGrid = fieldGrid.isWithinTolerance();   // a table that fine does not fit, sum the wells directly
+    }
+    if (!useForceGrid && attractorCutoff > 0) {
+        wellBins.update(wells, step.boxWidth, step.boxHeight, attractorCutoff);
+    }
+
+    // The other schemes start from the force at the current positions, which PEFRL leaves behind one drift
+    if (!forcesValid && integrator != integratorMode::pefrl && integrator != integratorMode::fixedPointVerlet) {
+        pool.parallelFor(n, particleChunkSize, [&](size_t begin, size_t end) {
+            computeForces(begin, end);
+        });
+    }
+    forcesValid = integrator != integratorMode::pefrl;
+
+    // Particles do not interact with each other, so every chunk runs the whole step (drift, forces, kick) on its own
+    if (integrator == integratorMode::forestRuth) {
+        // symmetric triple jump: w1 + w0 + w1 = 1, the negative middle substep cancels the third order error
+        const double cubeRootOfTwo = std::cbrt(2.0);
+        const double w1 = 1.0 / (2.0 - cubeRootOfTwo);
+        const double w0 = -cubeRootOfTwo / (2.0 - cubeRootOfTwo);
+        stepConstants outer = step;
+        stepConstants inner = step;
+        outer.dt = w1 * dt;
+        outer.driftFactor = 0.5 * outer.dt * outer.dt / mass;
+        outer.kickFactor = outer.dt * 0.5 / mass;
+        inner.dt = w0 * dt;
+        inner.driftFactor = 0.5 * inner.dt * inner.dt / mass;
+        inner.kickFactor = inner.dt * 0.5 / mass;
+        pool.parallelFor(n, particleChunkSize, [&](size_t begin, size_t end) {
+            for (size_t tile = begin; tile < end; tile += fusedTileSize) {
+                size_t tileEnd = std::min(tile + fusedTileSize, end);
+                fusedStep(outer, tile, tileEnd);    // the tile stays in L1 across the three substeps
+                fusedStep(inner, tile, tileEnd);
+                fusedStep(outer, tile, tileEnd);
+            }
+        });
+    }
+    else if (integrator == integratorMode::fixedPointVerlet) {
+        if (!latticeSynced) syncLattice();
+        pool.parallelFor(n, particleChunkSize, [&](size_t begin, size_t end) {
+            for (size_t tile = begin; tile < end; tile += fusedTileSize) {
+                latticeStep(step, tile, std::min(tile + fusedTileSize, end));
+            }
+        });
+        latticeForcesValid = true;
+    }
+    else if (integrator == integratorMode::pefrl) {
+        pool.parallelFor(n, particleChunkSize, [&](size_t begin, size_t end) {
+            for (size_t tile = begin; tile < end; tile += fusedTileSize) {
+                pefrlStep(step, tile, std::min(tile + fusedTileSize, end));
+            }
+        });
+    }
+    else if (integrator == integratorMode::fusedVelocityVerlet) {
+        pool.parallelFor(n, particleChunkSize, [&](size_t begin, size_t end) {
+            for (size_t tile = begin; tile < end; tile += fusedTileSize) {
+                fusedStep(step, tile, std::min(tile + fusedTileSize, end));
+            }
+        });
+    }
+    else {
+        pool.parallelFor(n, particleChunkSize, [&](size_t begin, size_t end) {
+            verletStep(step, begin, end);
+        });
+    }
+}
+
+void particleEnsemble::verletStep(const stepConstants& step, size_t begin, size_t end) {
+    const float dt = step.dt;
+
+    // raw stream pointers, so the loops below are plain unit-stride float loops
+    float* x = positions.x.data();
+    float* y = positions.y.data();
+    float* vx = v.x.data();
+    float* vy = v.y.data();
+    float* fx = f.x.data();
+    float* fy = f.y.data();
+    float* last_fx = last_f.x.data();
+    float* last_fy = last_f.y.data();
+#ifdef DYANTRA_PARTICLE_Z
+    float* z = positions.z.data();
+    float* vz = v.z.data();
+    float* fz = f.z.data();
+    float* last_fz = last_f.z.data();
+#endif
 
     // Update positions using the Velocity Verlet scheme
-    factor = 0.5 * dt * dt / mass;
-    for (size_t i = 0; i < positions.size(); ++i) {
-        last_positions[i] = positions[i];
-        
-        positions[i].x = positions[i].x + dt * v[i].x + factor * f[i].x;
-        positions[i].y = positions[i].y + dt * v[i].y + factor * f[i].y;
-        positions[i].z = positions[i].z + dt * v[i].z + factor * f[i].z;
+    std::copy(positions.x.begin() + begin, positions.x.begin() + end, last_positions.x.begin() + begin);
+    std::copy(positions.y.begin() + begin, positions.y.begin() + end, last_positions.y.begin() + begin);
+#ifdef DYANTRA_PARTICLE_Z
+    std::copy(positions.z.begin() + begin, positions.z.begin() + end, last_positions.z.begin() + begin);
+#endif
+    for (size_t i = begin; i < end; ++i) {
+        x[i] = x[i] + dt * vx[i] + step.driftFactor * fx[i];
+        y[i] = y[i] + dt * vy[i] + step.driftFactor * fy[i];
 
         // Reflect particles off the edges of the window
-        if (positions[i].x < 0 || positions[i].x >= ofGetWidth()) {
-            v[i].x *= -1.0;
-            positions[i].x = ofClamp(positions[i].x, 0, ofGetWidth());
+        if (x[i] < 0 || x[i] >= step.boxWidth) {
+            vx[i] *= -1.0;
+            x[i] = ofClamp(x[i], 0, step.boxWidth);
         }
-        if (positions[i].y < 0 || positions[i].y >= ofGetHeight()) {
-            v[i].y *= -1.0;
-            positions[i].y = ofClamp(positions[i].y, 0, ofGetHeight());
+        if (y[i] < 0 || y[i] >= step.boxHeight) {
+            vy[i] *= -1.0;
+            y[i] = ofClamp(y[i], 0, step.boxHeight);
         }
-        if (positions[i].z < 0 || positions[i].z >= 3000) {  // Assuming depth limit is 3000
-            v[i].z *= -1.0;
-            positions[i].z = ofClamp(positions[i].z, 0, 3000);
+#ifdef DYANTRA_PARTICLE_Z
+        z[i] = z[i] + dt * vz[i] + step.driftFactor * fz[i];
+        if (z[i] < 0 || z[i] >= 3000) {  // Assuming depth limit is 3000
+            vz[i] *= -1.0;
+            z[i] = ofClamp(z[i], 0, 3000);
         }
+#endif
     }
 
-    // Save the current forces to last_f
-    last_f = f;
-
-    // Zero out the current forces
-    ZeroForces();
+    // Save the current forces to last_f; the kernel overwrites f, so no separate zeroing pass is needed
+    std::copy(f.x.begin() + begin, f.x.begin() + end, last_f.x.begin() + begin);
+    std::copy(f.y.begin() + begin, f.y.begin() + end, last_f.y.begin() + begin);
+#ifdef DYANTRA_PARTICLE_Z
+    std::copy(f.z.begin() + begin, f.z.begin() + end, last_f.z.begin() + begin);
+#endif
 
     // Calculate forces acting on each particle due to attractors
-    for (size_t i = 0; i < positions.size(); ++i) {
-        glm::vec3 totalForce(0.0f);
-        for (const auto& attractor : attractorVec) {
-            glm::vec3 force = calculateGaussianForce(attractor, positions[i]);
-            totalForce += force;
+    computeForces(begin, end);
+
+    // Update velocities using the Velocity Verlet scheme
+    for (size_t i = begin; i < end; ++i) {
+        vx[i] += (fx[i] + last_fx[i]) * step.kickFactor;
+        vy[i] += (fy[i] + last_fy[i]) * step.kickFactor;
+#ifdef DYANTRA_PARTICLE_Z
+        vz[i] += (fz[i] + last_fz[i]) * step.kickFactor;
+#endif
+    }
+}
+
+// Same arithmetic as verletStep, but the previous force of a tile is parked in a small stack buffer that stays in L1
+// while the new force is computed, so last_f and last_positions are never touched and each tile is streamed once.
+void particleEnsemble::fusedStep(const stepConstants& step, size_t begin, size_t end) {
+    const float dt = step.dt;
+    alignas(64) float old_fx[fusedTileSize];
+    alignas(64) float old_fy[fusedTileSize];
+#ifdef DYANTRA_PARTICLE_Z
+    alignas(64) float old_fz[fusedTileSize];
+#endif
+
+    float* x = positions.x.data();
+    float* y = positions.y.data();
+    float* vx = v.x.data();
+    float* vy = v.y.data();
+    float* fx = f.x.data();
+    float* fy = f.y.data();
+#ifdef DYANTRA_PARTICLE_Z
+    float* z = positions.z.data();
+    float* vz = v.z.data();
+    float* fz = f.z.data();
+#endif
+
+    // drift, remembering the force it used
+    for (size_t i = begin; i < end; ++i) {
+        const size_t t = i - begin;
+        old_fx[t] = fx[i];
+        old_fy[t] = fy[i];
+        x[i] = x[i] + dt * vx[i] + step.driftFactor * old_fx[t];
+        y[i] = y[i] + dt * vy[i] + step.driftFactor * old_fy[t];
+
+        // Reflect particles off the edges of the window
+        if (x[i] < 0 || x[i] >= step.boxWidth) {
+            vx[i] *= -1.0;
+            x[i] = ofClamp(x[i], 0, step.boxWidth);
+        }
+        if (y[i] < 0 || y[i] >= step.boxHeight) {
+            vy[i] *= -1.0;
+            y[i] = ofClamp(y[i], 0, step.boxHeight);
         }
-        f[i] = totalForce;
+#ifdef DYANTRA_PARTICLE_Z
+        old_fz[t] = fz[i];
+        z[i] = z[i] + dt * vz[i] + step.driftFactor * old_fz[t];
+        if (z[i] < 0 || z[i] >= 3000) {  // Assuming depth limit is 3000
+            vz[i] *= -1.0;
+            z[i] = ofClamp(z[i], 0, 3000);
+        }
+#endif
     }
 
-    // Update velocities using the Velocity Verlet scheme
-    factor = dt * 0.5 / mass;
-    for (size_t i = 0; i < v.size(); ++i) {
-        v[i].x += (f[i].x + last_f[i].x) * factor;
-        v[i].y += (f[i].y + last_f[i].y) * factor;
-        v[i].z += (f[i].z + last_f[i].z) * factor;
+    // new force, written straight over the old one
+    computeForces(begin, end);
+
+    // kick with the average of old and new force
+    for (size_t i = begin; i < end; ++i) {
+        const size_t t = i - begin;
+        vx[i] += (fx[i] + old_fx[t]) * step.kickFactor;
+        vy[i] += (fy[i] + old_fy[t]) * step.kickFactor;
+#ifdef DYANTRA_PARTICLE_Z
+        vz[i] += (fz[i] + old_fz[t]) * step.kickFactor;
+#endif
+    }
+}
+
+// Omelyan, Mryglod & Folk, Comput. Phys. Commun. 146, 188 (2002), eq. 20: drift, kick, ..., drift with coefficients
+// chosen to minimise the fifth order error. The force is evaluated at the drifted positions before every kick.
+void particleEnsemble::pefrlStep(const stepConstants& step, size_t begin, size_t end) {
+    const float xi = 0.1786178958448091f;
+    const float lambda = -0.2123418310626054f;
+    const float chi = -0.06626458266981849f;
+    const float dt = step.dt;
+
+    drift(step, begin, end, xi * dt);
+    computeForces(begin, end);
+    kick(begin, end, 0.5f * (1.0f - 2.0f * lambda) * dt);
+    drift(step, begin, end, chi * dt);
+    computeForces(begin, end);
+    kick(begin, end, lambda * dt);
+    drift(step, begin, end, (1.0f - 2.0f * (chi + xi)) * dt);
+    computeForces(begin, end);
+    kick(begin, end, lambda * dt);
+    drift(step, begin, end, chi * dt);
+    computeForces(begin, end);
+    kick(begin, end, 0.5f * (1.0f - 2.0f * lambda) * dt);
+    drift(step, begin, end, xi * dt);
+}
+
+void particleEnsemble::drift(const stepConstants& step, size_t begin, size_t end, float h) {
+    float* x = positions.x.data();
+    float* y = positions.y.data();
+    float* vx = v.x.data();
+    float* vy = v.y.data();
+#ifdef DYANTRA_PARTICLE_Z
+    float* z = positions.z.data();
+    float* vz = v.z.data();
+#endif
+    for (size_t i = begin; i < end; ++i) {
+        x[i] += h * vx[i];
+        y[i] += h * vy[i];
+
+        // Reflect particles off the edges of the window
+        if (x[i] < 0 || x[i] >= step.boxWidth) {
+            vx[i] *= -1.0;
+            x[i] = ofClamp(x[i], 0, step.boxWidth);
+        }
+        if (y[i] < 0 || y[i] >= step.boxHeight) {
+            vy[i] *= -1.0;
+            y[i] = ofClamp(y[i], 0, step.boxHeight);
+        }
+#ifdef DYANTRA_PARTICLE_Z
+        z[i] += h * vz[i];
+        if (z[i] < 0 || z[i] >= 3000) {  // Assuming depth limit is 3000
+            vz[i] *= -1.0;
+            z[i] = ofClamp(z[i], 0, 3000);
+        }
+#endif
+    }
+}
+
+void particleEnsemble::kick(size_t begin, size_t end, float h) {
+    const float mass = 1.0f;
+    const float factor = h / mass;
+    float* vx = v.x.data();
+    float* vy = v.y.data();
+    const float* fx = f.x.data();
+    const float* fy = f.y.data();
+    for (size_t i = begin; i < end; ++i) {
+        vx[i] += factor * fx[i];
+        vy[i] += factor * fy[i];
+    }
+#ifdef DYANTRA_PARTICLE_Z
+    float* vz = v.z.data();
+    const float* fz = f.z.data();
+    for (size_t i = begin; i < end; ++i) {
+        vz[i] += factor * fz[i];
+    }
+#endif
+}
+
+namespace {
+    // Round half away from zero: odd, so the increment of a step with -dt is exactly minus that of the step with dt.
+    // Clamped first, so a runaway value saturates instead of overflowing the conversion.
+    inline int32_t roundToLattice(float a) {
+        a = std::min(std::max(a, -1.0e9f), 1.0e9f);
+        return int32_t(a + std::copysign(0.5f, a));
+    }
+}
+
+void particleEnsemble::syncLattice() {
+    const size_t n = positions.size();
+    latticeX.resize(n);
+    latticeY.resize(n);
+    latticeVx.resize(n);
+    latticeVy.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        latticeX[i] = roundToLattice(positions.x[i] * latticePositionScale);
+        latticeY[i] = roundToLattice(positions.y[i] * latticePositionScale);
+        latticeVx[i] = roundToLattice(v.x[i] * latticeVelocityScale);
+        latticeVy[i] = roundToLattice(v.y[i] * latticeVelocityScale);
     }
+    latticeSynced = true;
+    latticeForcesValid = false;
 }
 
-glm::vec3 particleEnsemble::calculateGaussianForce(const attractor& attractorObject, const glm::vec3& particlePosition) const {
-    float dx = particlePosition.x - attractorObject.getCenter().x;
-    float dy = particlePosition.y - attractorObject.getCenter().y;
-    float dz = particlePosition.z - attractorObject.getCenter().z;
+// Kick, drift, kick. Each half is a shear, p += K(x) or x += D(p), with K and D odd in dt, so the step with -dt runs
+// the same shears backwards. Walls mirror the position and flip the velocity, which the reverse drift undoes as well.
+// The loops are branch-free integer/float arithmetic over the tile and vectorize like the float passes.
+void particleEnsemble::latticeStep(const stepConstants& step, size_t begin, size_t end) {
+    const float mass = 1.0f;
+    const float kickScale = 0.5f * step.dt / mass * latticeVelocityScale;
+    const float driftScale = step.dt * (latticePositionScale / latticeVelocityScale);
+    const float toPosition = 1.0f / latticePositionScale;
+    const float toVelocity = 1.0f / latticeVelocityScale;
+    const int32_t width = int32_t(step.boxWidth * latticePositionScale);
+    const int32_t height = int32_t(step.boxHeight * latticePositionScale);
 
-    float exp_numerator = dx * dx + dy * dy + dz * dz;
-    float prefactor = -1.0 * attractorObject.get_coefficient() * exp(exp_numerator / attractorObject.get_exp_denominator());
+    int32_t* px = latticeX.data();
+    int32_t* py = latticeY.data();
+    int32_t* vx = latticeVx.data();
+    int32_t* vy = latticeVy.data();
+    const float* fx = f.x.data();
+    const float* fy = f.y.data();
+    float* x = positions.x.data();
+    float* y = positions.y.data();
 
-    glm::vec3 forceVector;
-    forceVector.x = prefactor * dx;
-    forceVector.y = prefactor * dy;
-    forceVector.z = prefactor * dz;
+    if (!latticeForcesValid) {
+        for (size_t i = begin; i < end; ++i) {
+            x[i] = px[i] * toPosition;
+            y[i] = py[i] * toPosition;
+        }
+        computeForces(begin, end);
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+        vx[i] += roundToLattice(kickScale * fx[i]);
+        vy[i] += roundToLattice(kickScale * fy[i]);
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+        int32_t nx = px[i] + roundToLattice(driftScale * float(vx[i]));
+        int32_t ny = py[i] + roundToLattice(driftScale * float(vy[i]));
+
+        // Mirror off the walls, half a lattice step outside [0, width], so no point maps onto itself: the reverse drift
+        // then lands outside again and mirrors back onto the point it came from
+        bool lowX = nx < 0, highX = nx > width;
+        bool lowY = ny < 0, highY = ny > height;
+        px[i] = lowX ? -1 - nx : (highX ? 2 * width + 1 - nx : nx);
+        py[i] = lowY ? -1 - ny : (highY ? 2 * height + 1 - ny : ny);
+        vx[i] = (lowX || highX) ? -vx[i] : vx[i];
+        vy[i] = (lowY || highY) ? -vy[i] : vy[i];
+
+        x[i] = px[i] * toPosition;
+        y[i] = py[i] * toPosition;
+    }
+
+    computeForces(begin, end);
+
+    float* fvx = v.x.data();
+    float* fvy = v.y.data();
+    for (size_t i = begin; i < end; ++i) {
+        vx[i] += roundToLattice(kickScale * fx[i]);
+        vy[i] += roundToLattice(kickScale * fy[i]);
+        fvx[i] = vx[i] * toVelocity;
+        fvy[i] = vy[i] * toVelocity;
+    }
+}
 
-    return forceVector;
+const char* integratorModeName(integratorMode mode) {
+    switch (mode) {
+        case integratorMode::velocityVerlet: return "Velocity Verlet";
+        case integratorMode::fusedVelocityVerlet: return "Velocity Verlet (fused)";
+        case integratorMode::forestRuth: return "Forest-Ruth";
+        case integratorMode::pefrl: return "PEFRL";
+        case integratorMode::fixedPointVerlet: return "Fixed-point Verlet";
+    }
+    return "";
+}
+
+void particleEnsemble::setIntegratorMode(integratorMode mode) {
+    if (mode == integrator) return;
+    integrator = mode;
+    latticeSynced = false;
+    if (integrator != integratorMode::fixedPointVerlet) {
+        latticeX = alignedIntVector();
+        latticeY = alignedIntVector();
+        latticeVx = alignedIntVector();
+        latticeVy = alignedIntVector();
+    }
+    if (integrator == integratorMode::velocityVerlet) {
+        // the classic scheme needs its history streams back
+        last_positions = positions;
+        last_f = f;
+    }
+    else {
+        // release the memory, the fused and higher order passes do not need it
+        last_positions = particleStreams();
+        last_f = particleStreams();
+    }
 }
 
+void particleEnsemble::computeForces(size_t begin, size_t end) {
+    if (useForceGrid) {
+        fieldGrid.sample(positions, f, begin, end);
+    }
+    else if (attractorCutoff > 0 && wells.size() > 1) {
+        // Every particle sums the attractors listed for its own cell, so its force depends only on where it is.
+        // The particles of a tile are sorted by cell into scratch streams, and each run of one cell goes through
+        // the vector kernel in a single call before the forces are scattered back.
+        thread_local std::vector<uint32_t> cells;
+        thread_local std::vector<uint32_t> order;
+        thread_local particleStreams tilePositions;
+        thread_local particleStreams tileForces;
+        for (size_t tile = begin; tile < end; tile += cullTileSize) {
+            const size_t count = std::min(tile + cullTileSize, end) - tile;
+            cells.resize(count);
+            order.resize(count);
+            for (size_t t = 0; t < count; ++t) {
+                cells[t] = wellBins.cellOf(positions.x[tile + t], positions.y[tile + t]);
+                order[t] = uint32_t(t);
+            }
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return cells[a] < cells[b]; });
+
+            tilePositions.resize(count);
+            tileForces.resize(count);
+            for (size_t t = 0; t < count; ++t) {
+                tilePositions.x[t] = positions.x[tile + order[t]];
+                tilePositions.y[t] = positions.y[tile + order[t]];
+#ifdef DYANTRA_PARTICLE_Z
+                tilePositions.z[t] = positions.z[tile + order[t]];
+#endif
+            }
+            for (size_t run = 0; run < count;) {
+                uint32_t cell = cells[order[run]];
+                size_t runEnd = run + 1;
+                while (runEnd < count && cells[order[runEnd]] == cell) ++runEnd;
+                size_t nCellWells;
+                const gaussianWell* cellWells = wellBins.cellWells(cell, nCellWells);
+                computeGaussianForces(tilePositions, tileForces, run, runEnd, cellWells, nCellWells, forceAccuracy);
+                run = runEnd;
+            }
+            for (size_t t = 0; t < count; ++t) {
+                f.x[tile + order[t]] = tileForces.x[t];
+                f.y[tile + order[t]] = tileForces.y[t];
+#ifdef DYANTRA_PARTICLE_Z
+                f.z[tile + order[t]] = tileForces.z[t];
+#endif
+            }
+        }
+    }
+    else {
+        computeGaussianForces(positions, f, begin, end, wells.data(), wells.size(), forceAccuracy);
+    }
+}
@@ -3,6 +3,52 @@
 #include "ofMain.h"
 #include "attractor.h"  // Include the attractor class
 #include "particleRenderer.h"
+#include "particleStreams.h"
+#include "forceKernel.h"
+#include "workerPool.h"
+#include "forceGrid.h"
+#include "attractorBins.h"
+#include "tripleBuffer.h"
+
+// velocityVerlet:      drift, force and kick passes, keeping last_positions and last_f
+// fusedVelocityVerlet: one streaming pass per particle tile, same trajectory without the history streams
+// forestRuth:          4th order, three fused velocity Verlet substeps of w1, w0, w1 times dt (Forest-Ruth / Yoshida);
+//                      three force evaluations per step
+// pefrl:               4th order position-extended Forest-Ruth-like scheme (Omelyan, Mryglod & Folk); four force
+//                      evaluations per step, but an error constant ~100x smaller than forestRuth
+// fixedPointVerlet:    velocity Verlet on an integer lattice (after Levesque & Verlet), bit-exactly reversible:
+//                      a step with -dt restores the previous state exactly, however long the run
+// All of them are symmetric compositions, so a step with -dt undoes a step with dt and the time reversal still works;
+// the floating point ones only up to rounding.
+enum class integratorMode {
+    velocityVerlet,
+    fusedVelocityVerlet,
+    forestRuth,
+    pefrl,
+    fixedPointVerlet
+};
+
+const char* integratorModeName(integratorMode mode);
+
+// Everything a step carries over from the previous one, for checkpoints (see checkpointStore.h).
+// The attractors and integrator settings are not part of it.
+struct particleState {
+    integratorMode integrator = integratorMode::fusedVelocityVerlet;
+    particleStreams positions;
+    particleStreams v;
+    particleStreams f;
+    particleStreams last_positions;     // velocityVerlet only
+    particleStreams last_f;             // velocityVerlet only
+    alignedIntVector latticeX;          // fixedPointVerlet only
+    alignedIntVector latticeY;
+    alignedIntVector latticeVx;
+    alignedIntVector latticeVy;
+    bool latticeSynced = false;
+    bool latticeForcesValid = false;
+    bool forcesValid = true;
+
+    size_t bytes() const;
+};
 
 class particleEnsemble {
 public:
@@ -12,9 +58,7 @@ public:
     void drawVBO();
     void initialize(const std::vector<glm::vec3>& initialPositions); // Initialization function
     void ZeroForces() {  // Zero forces function
-        for (auto& force : f) {
-            force = glm::vec3(0, 0, 0);
-        }
+        f.fill(0.0f);
     };
 
     void radial_update(float dt, float angularVelocity, const glm::vec3& midpoint); // New update function
@@ -23,22 +67,105 @@ public:
     void reinitialize(const std::vector<glm::vec3>& initialPositions);
     void update(const std::vector<glm::vec3>& initialPositions);
     
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> last_positions; // Data member to save positions from the previous timestep
-    std::vector<glm::vec3> v; // Data member to save velocities for the present timestep
-    std::vector<glm::vec3> f; // Data member to save forces acting on each particle at the present timestep
-    std::vector<glm::vec3> last_f; // Data member to save forces acting on each particle at the previous timestep
+    // per-particle state, stored as separate x/y(/z) streams (see particleStreams.h)
+    particleStreams positions;
+    particleStreams last_positions; // Data member to save positions from the previous timestep (velocityVerlet mode only)
+    particleStreams v; // Data member to save velocities for the present timestep
+    particleStreams f; // Data member to save forces acting on each particle at the present timestep
+    particleStreams last_f; // Data member to save forces acting on each particle at the previous timestep (velocityVerlet mode only)
 
-    std::vector<float> radii;
-    std::vector<float> masses;
+    alignedFloatVector radii;
+    alignedFloatVector masses;
 
 	particleRenderer vboRenderer;
 
-    const std::vector<glm::vec3>& getPositions() const {
+    forceKernelAccuracy forceAccuracy = forceKernelAccuracy::exact; // exact std::exp, or the faster polynomial exp
+
+    // From this many attractors on, forces are interpolated from a tabulated field (forceGrid.h); 0 disables it
+    int forceGridThreshold = 32;
+    float forceGridTolerance = 1e-3f;  // error bound of each force component, relative to the strongest well's peak force
+    bool isUsingForceGrid() const { return useForceGrid; }
+
+    // Attractors further than this many sigma from a particle are skipped (0 = off, ~14.5 = no change in float)
+    float attractorCutoff = 0.0f;
+
+    void setThreadCount(int nThreads) { pool.setThreadCount(nThreads); } // threads used by vv_propagatePositionsVelocities
+    int getThreadCount() const { return pool.getThreadCount(); }
+    workerPool& getWorkerPool() { return pool; }   // for other parallel work, so it follows the same thread count
+
+    // Walls the particles bounce off; 0 x 0 (the default) follows the window size
+    void setBoundary(float width, float height) { boundaryWidth = width; boundaryHeight = height; }
+    float getBoundaryWidth() const { return boundaryWidth; }
+    float getBoundaryHeight() const { return boundaryHeight; }
+
+    void setIntegratorMode(integratorMode mode);
+    integratorMode getIntegratorMode() const { return integrator; }
+
+    const particleStreams& getPositions() const {
         return positions;
     }
+
+    // Checkpoints. restoreState also switches to the integrator mode the state was saved in.
+    void saveState(particleState& state) const;
+    void restoreState(const particleState& state);
+    // Bumped whenever the positions are set from outside (initialize, reinitialize, update), not by a step or a restore
+    long long getEditCount() const { return editCount; }
+
+    // While another thread integrates (see simulationThread.h), draw() and drawVBO() show the last published
+    // snapshot instead of the live positions; initialize, reinitialize and update publish their result themselves.
+    void setSnapshotDrawing(bool enabled);
+    bool isSnapshotDrawing() const { return snapshotDrawing; }
+    void publishPositions();                                                    // on the integrating thread
+    bool isSnapshotPending() const { return positionSnapshots.isPending(); }   // published but not drawn yet
     
 private:
-    glm::vec3 calculateGaussianForce(const attractor& attractorObject, const glm::vec3& particlePosition) const; // Helper function
+    const particleStreams& drawnPositions() const;
+
+    struct stepConstants {
+        float dt;
+        float driftFactor;  // 0.5 * dt^2 / m
+        float kickFactor;   // 0.5 * dt / m
+        float boxWidth;
+        float boxHeight;
+    };
+    void verletStep(const stepConstants& step, size_t begin, size_t end);
+    void fusedStep(const stepConstants& step, size_t begin, size_t end);
+    void pefrlStep(const stepConstants& step, size_t begin, size_t end);
+    void drift(const stepConstants& step, size_t begin, size_t end, float h);  // x += h v, reflecting off the walls
+    void kick(size_t begin, size_t end, float h);                               // v += h f / m
+
+    // fixedPointVerlet: positions in 1/latticePositionScale px and velocities in 1/latticeVelocityScale px per time
+    // unit, as int32. Every increment is rounded half away from zero, so the increment for -dt is exactly minus the
+    // one for dt and each kick or drift is undone bit for bit. The float streams are refreshed after every step.
+    // Planar: with DYANTRA_PARTICLE_Z the z stream stays where it is.
+    static constexpr float latticePositionScale = 65536.0f;    // int32 covers 32768 px
+    static constexpr float latticeVelocityScale = 4096.0f;     // int32 covers 524288 px per time unit
+    void syncLattice();     // quantizes positions and v
+    void latticeStep(const stepConstants& step, size_t begin, size_t end);
+    alignedIntVector latticeX;
+    alignedIntVector latticeY;
+    alignedIntVector latticeVx;
+    alignedIntVector latticeVy;
+    bool latticeSynced = false;         // false after initialize/update/reinitialize or a mode switch
+    bool latticeForcesValid = false;    // f holds the force at the lattice positions (first same as last)
+    bool forcesValid = true;            // f holds the force at positions; not after a PEFRL step, which ends with a drift
+    void computeForces(size_t begin, size_t end);   // writes f for [begin, end) with the direct kernel or the grid
+
+    integratorMode integrator = integratorMode::fusedVelocityVerlet;
+    float boundaryWidth = 0.0f;
+    float boundaryHeight = 0.0f;
+    std::vector<gaussianWell> wells; // attractor parameters packed for the force kernel, refilled every step
+    forceGrid fieldGrid;
+    bool useForceGrid = false;
+    attractorBins wellBins;  // attractors listed per window cell, for attractorCutoff
+
+    long long editCount = 0;
+    bool snapshotDrawing = false;
+    mutable tripleBuffer<particleStreams> positionSnapshots;   // draw() is const but takes the newest snapshot
+
+    workerPool pool;
+    static const size_t particleChunkSize = 2048; // ~80 kB of stream data per chunk, stays in L2 through the step
+    static const size_t fusedTileSize = 256;      // particles per fused pass, old forces kept in a 2 kB stack buffer
+    static const size_t cullTileSize = 256;       // particles sorted by bin cell together when attractorCutoff is on
 };
 
@@ -16,10 +16,26 @@ void particleRenderer::load() {
 	if (!shaderLoaded) {
 		ofLogError("particleRenderer") << "Failed to load particle shaders!";
 	}
+	yAttributeLocation = shader.getAttributeLocation("py");
+	loaded = true;
+}
+
+void particleRenderer::update(const particleStreams &positions) {
+	// upload the x and y streams straight from the particle arrays, no repacking
+	if (!loaded) load();
+	numVertices = positions.size();
+	if (numVertices == 0) return;
+	vbo.setVertexData(positions.x.data(), 1, numVertices, GL_DYNAMIC_DRAW);
+	vbo.setAttributeData(yAttributeLocation, positions.y.data(), 1, numVertices, GL_DYNAMIC_DRAW);
 }
 
 void particleRenderer::update(const std::vector<glm::vec3> &positions) {
-	vbo.setVertexData(&positions[0], positions.size(), GL_DYNAMIC_DRAW);
+	// interleaved points feed the same two attributes through a stride
+	if (!loaded) load();
+	numVertices = positions.size();
+	if (numVertices == 0) return;
+	vbo.setVertexData(&positions[0].x, 1, numVertices, GL_DYNAMIC_DRAW, sizeof(glm::vec3));
+	vbo.setAttributeData(yAttributeLocation, &positions[0].y, 1, numVertices, GL_DYNAMIC_DRAW, sizeof(glm::vec3));
 }
 
 void particleRenderer::draw() const {
@@ -32,7 +48,7 @@ void particleRenderer::draw() const {
 	shader.setUniform4f("color", ofGetStyle().color);
 	shader.setUniform1f("size", ofGetStyle().pointSize);
 
-	vbo.draw(GL_POINTS, 0, vbo.getNumVertices());
+	vbo.draw(GL_POINTS, 0, numVertices);
 
 	shader.end();
 	texture.unbind();
@@ -1,16 +1,24 @@
 #pragma once
 
 #include "ofMain.h"
+#include "particleStreams.h"
 
 class particleRenderer {
 public:
 	particleRenderer();
 
-	void load();
+	void load();    // update() calls this on first use, so nothing touches GL until something is drawn
 	void draw() const;
+	void update(const particleStreams &positions);
 	void update(const std::vector<glm::vec3> &positions);
 
 	ofShader shader;
 	ofImage texture;
 	ofVbo vbo;
+
+private:
+	// x is fed through the position attribute, y through its own attribute (see shaders/particle.vert)
+	int yAttributeLocation = -1;
+	int numVertices = 0;
+	bool loaded = false;
 };
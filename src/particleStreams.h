@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include "glm/vec3.hpp"
+
+// The simulation is planar, so particle data is stored as separate x/y streams.
+// Define DYANTRA_PARTICLE_Z (e.g. in config.make or the project settings) to carry a z stream as well.
+
+// Allocator handing out cache-line aligned blocks so the streams can be loaded with aligned SIMD loads
+template <class T, std::size_t Alignment = 64>
+struct alignedAllocator {
+    typedef T value_type;
+
+    template <class U>
+    struct rebind { typedef alignedAllocator<U, Alignment> other; };
+
+    alignedAllocator() noexcept {}
+    template <class U>
+    alignedAllocator(const alignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if (n == 0) return nullptr;
+        std::size_t bytes = ((n * sizeof(T) + Alignment - 1) / Alignment) * Alignment;  // round up to a whole number of lines
+#ifdef _WIN32
+        void* p = _aligned_malloc(bytes, Alignment);
+#else
+        void* p = nullptr;
+        if (posix_memalign(&p, Alignment, bytes) != 0) p = nullptr;
+#endif
+        if (!p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, std::size_t) noexcept {
+#ifdef _WIN32
+        _aligned_free(p);
+#else
+        free(p);
+#endif
+    }
+
+    template <class U>
+    bool operator==(const alignedAllocator<U, Alignment>&) const noexcept { return true; }
+    template <class U>
+    bool operator!=(const alignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+typedef std::vector<float, alignedAllocator<float>> alignedFloatVector;
+typedef std::vector<int32_t, alignedAllocator<int32_t>> alignedIntVector;
+
+// One vector quantity (position, velocity, force...) for every particle, stored as structure-of-arrays
+struct particleStreams {
+    alignedFloatVector x;
+    alignedFloatVector y;
+#ifdef DYANTRA_PARTICLE_Z
+    alignedFloatVector z;
+#endif
+
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+
+    void resize(size_t n, float value = 0.0f) {
+        x.resize(n, value);
+        y.resize(n, value);
+#ifdef DYANTRA_PARTICLE_Z
+        z.resize(n, value);
+#endif
+    }
+
+    void fill(float value) {
+        std::fill(x.begin(), x.end(), value);
+        std::fill(y.begin(), y.end(), value);
+#ifdef DYANTRA_PARTICLE_Z
+        std::fill(z.begin(), z.end(), value);
+#endif
+    }
+
+    // Copy interleaved points into the streams, skipping the first 'first' entries
+    void assign(const std::vector<glm::vec3>& points, size_t first = 0) {
+        size_t n = points.size() > first ? points.size() - first : 0;
+        x.resize(n);
+        y.resize(n);
+#ifdef DYANTRA_PARTICLE_Z
+        z.resize(n);
+#endif
+        for (size_t i = 0; i < n; ++i) {
+            x[i] = points[i + first].x;
+            y[i] = points[i + first].y;
+#ifdef DYANTRA_PARTICLE_Z
+            z[i] = points[i + first].z;
+#endif
+        }
+    }
+
+    glm::vec3 get(size_t i) const {
+#ifdef DYANTRA_PARTICLE_Z
+        return glm::vec3(x[i], y[i], z[i]);
+#else
+        return glm::vec3(x[i], y[i], 0.0f);
+#endif
+    }
+
+    void set(size_t i, const glm::vec3& p) {
+        x[i] = p.x;
+        y[i] = p.y;
+#ifdef DYANTRA_PARTICLE_Z
+        z[i] = p.z;
+#endif
+    }
+};
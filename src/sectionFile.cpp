@@ -0,0 +1,83 @@
+#include "sectionFile.h"
+#include <fstream>
+#include <map>
+
+namespace sectionFile {
+
+bool write(const std::string& path, const void* header, size_t headerBytes, const std::vector<section>& sections) {
+    std::vector<entry> entries(sections.size());
+    uint64_t offset = headerBytes + entries.size() * sizeof(entry);
+    for (size_t i = 0; i < sections.size(); ++i) {
+        offset = (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+        entries[i] = {sections[i].id, 0, offset, sections[i].bytes};
+        offset += sections[i].bytes;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    file.write(static_cast<const char*>(header), headerBytes);
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(entry));
+    uint64_t written = headerBytes + entries.size() * sizeof(entry);
+    static const char padding[sectionAlignment] = {};
+    for (size_t i = 0; i < sections.size(); ++i) {
+        file.write(padding, entries[i].offset - written);
+        file.write(static_cast<const char*>(sections[i].data), sections[i].bytes);
+        written = entries[i].offset + sections[i].bytes;
+    }
+    return bool(file);
+}
+
+void encodeStrings(const std::vector<std::string>& strings, std::vector<uint32_t>& indices, std::string& table) {
+    std::map<std::string, uint32_t> tableIndices;
+    indices.clear();
+    table.clear();
+    for (const auto& s : strings) {
+        auto it = tableIndices.find(s);
+        if (it == tableIndices.end()) {
+            it = tableIndices.emplace(s, uint32_t(tableIndices.size())).first;
+            table.append(s);
+            table.push_back('\0');
+        }
+        indices.push_back(it->second);
+    }
+}
+
+std::vector<std::string> decodeTable(const unsigned char* table, uint64_t bytes) {
+    std::vector<std::string> strings;
+    for (uint64_t start = 0, end = 0; end < bytes; ++end) {
+        if (table[end] == '\0') {
+            strings.emplace_back(reinterpret_cast<const char*>(table + start), size_t(end - start));
+            start = end + 1;
+        }
+    }
+    return strings;
+}
+
+bool reader::readTable(uint32_t nSections) {
+    if (nSections > (size - headerBytes) / sizeof(entry)) return false;
+    entries.resize(nSections);
+    std::memcpy(entries.data(), data + headerBytes, entries.size() * sizeof(entry));
+    for (const auto& e : entries) {
+        if (e.offset > size || e.bytes > size - e.offset) return false;
+    }
+    return true;
+}
+
+const unsigned char* reader::find(uint32_t id, uint64_t& bytes) const {
+    for (const auto& e : entries) {
+        if (e.id == id) {
+            bytes = e.bytes;
+            return data + e.offset;
+        }
+    }
+    bytes = 0;
+    return nullptr;
+}
+
+std::string reader::readString(uint32_t id) const {
+    uint64_t bytes;
+    const unsigned char* p = find(id, bytes);
+    return p ? std::string(reinterpret_cast<const char*>(p), size_t(bytes)) : std::string();
+}
+
+}
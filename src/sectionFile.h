@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "mappedFile.h"
+
+// The container of the binary files (.dysnap, .dyskel): the file's own fixed header, a table of sections, then the
+// sections at 64-byte aligned offsets. Array sections hold the arrays as they are in memory (native byte order, which
+// the headers record), so a loader maps the file and copies each section in one go. Readers skip sections they do not
+// know, so adding one needs no new version.
+namespace sectionFile {
+    const uint32_t byteOrderMark = 0x01020304;
+    const uint64_t sectionAlignment = 64;
+
+    struct entry {
+        uint32_t id;
+        uint32_t reserved;
+        uint64_t offset;    // from the start of the file
+        uint64_t bytes;
+    };
+
+    struct section {
+        uint32_t id;
+        const void* data;
+        uint64_t bytes;
+    };
+
+    // Writes header, table and sections; the header tells the reader how many sections there are
+    bool write(const std::string& path, const void* header, size_t headerBytes, const std::vector<section>& sections);
+
+    // Strings that repeat, e.g. the path ID of every skeleton point: an index per string into a table of distinct
+    // ones, NUL-terminated in order of first use
+    void encodeStrings(const std::vector<std::string>& strings, std::vector<uint32_t>& indices, std::string& table);
+    std::vector<std::string> decodeTable(const unsigned char* table, uint64_t bytes);
+
+    // The sections of a mapped file, bounds-checked
+    class reader {
+    public:
+        // header is copied out of the file; false if the file is shorter than the header and the table
+        template <class headerType>
+        bool readHeader(const mappedFile& file, headerType& header) {
+            data = file.getData();
+            size = file.getSize();
+            if (size < sizeof(headerType)) return false;
+            std::memcpy(&header, data, sizeof(headerType));
+            headerBytes = sizeof(headerType);
+            return true;
+        }
+        // the table after the header, once the header is known to be one this version reads
+        bool readTable(uint32_t nSections);
+
+        const unsigned char* find(uint32_t id, uint64_t& bytes) const;
+
+        // An array of exactly n elements, or nothing
+        template <class vectorType>
+        bool readArray(uint32_t id, size_t n, vectorType& values) const {
+            typedef typename vectorType::value_type valueType;
+            uint64_t bytes;
+            const unsigned char* p = find(id, bytes);
+            values.clear();
+            if (p == nullptr) return false;
+            if (bytes != n * sizeof(valueType)) return false;
+            values.resize(n);
+            if (n > 0) std::memcpy(values.data(), p, bytes);
+            return true;
+        }
+
+        // The whole section, however many elements it holds; nothing if it is not a whole number of them
+        template <class vectorType>
+        bool readArray(uint32_t id, vectorType& values) const {
+            uint64_t bytes;
+            find(id, bytes);
+            return bytes % sizeof(typename vectorType::value_type) == 0
+                   && readArray(id, size_t(bytes / sizeof(typename vectorType::value_type)), values);
+        }
+
+        template <class recordType>
+        bool readRecord(uint32_t id, recordType& record) const {
+            uint64_t bytes;
+            const unsigned char* p = find(id, bytes);
+            if (p == nullptr || bytes != sizeof(recordType)) return false;
+            std::memcpy(&record, p, sizeof(record));
+            return true;
+        }
+
+        std::string readString(uint32_t id) const;  // empty if missing
+
+    private:
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+        size_t headerBytes = 0;
+        std::vector<entry> entries;
+    };
+}
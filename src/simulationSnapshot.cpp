@@ -0,0 +1,266 @@
+#include "simulationSnapshot.h"
+#include "sectionFile.h"
+#include <cstring>
+
+namespace {
+    const char snapshotMagic[8] = {'D', 'Y', 'S', 'N', 'A', 'P', 0, 0};
+    const uint32_t snapshotVersion = 1;
+
+    struct fileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t nParticles;
+        uint32_t integrator;
+        uint32_t latticeFlags;      // 1 = latticeSynced, 2 = latticeForcesValid, 4 = f is stale (after a PEFRL step)
+        float boundaryWidth;
+        float boundaryHeight;
+        uint32_t nSections;
+        uint32_t reserved;
+    };
+
+    // A particle stream is streamBase + 4 * stream + component (0 = x, 1 = y, 2 = z)
+    enum sectionId : uint32_t {
+        streamBase = 0,     // positions, v, f, last_positions, last_f
+        latticeX = 32,
+        latticeY,
+        latticeVx,
+        latticeVy,
+        scheduleSection = 64,
+        attractorSection,   // cx, cy, radius, amplitude per attractor
+        skeletonPoints,     // x, y, z per point
+        skeletonPathIndices,// uint32 per point into skeletonPathLabels
+        skeletonPathLabels, // NUL-terminated strings
+        skeletonFile,
+        skeletonTransform,  // requested points, midpoint xyz, translation xyz, scale, rotation
+        forceSection        // forceRecord
+    };
+
+    struct scheduleRecord {
+        float timestep;
+        int32_t reversalActive;
+        int32_t reversalTimestep;
+        int32_t nTimeReversalSteps;
+        int64_t elapsedTimesteps;
+        int32_t timeForward;
+        int32_t timeReversalInProgress;
+        int32_t timeReversalStepCounter;
+        int32_t nTimeReversalCalls;
+        float lastTimeStep;
+        float originalTimeStep;
+    };
+
+    struct forceRecord {
+        int32_t fastExp;
+        int32_t forceGridThreshold;
+        float forceGridTolerance;
+        float attractorCutoff;
+    };
+
+    struct transformRecord {
+        int32_t requestedPoints;
+        float midpoint[3];
+        float translation[3];
+        float scale;
+        float rotation;
+    };
+
+    typedef sectionFile::section section;
+
+    void addStreams(std::vector<section>& sections, uint32_t stream, const particleStreams& streams) {
+        uint32_t id = streamBase + 4 * stream;
+        if (streams.empty()) return;
+        sections.push_back({id, streams.x.data(), streams.x.size() * sizeof(float)});
+        sections.push_back({id + 1, streams.y.data(), streams.y.size() * sizeof(float)});
+#ifdef DYANTRA_PARTICLE_Z
+        sections.push_back({id + 2, streams.z.data(), streams.z.size() * sizeof(float)});
+#endif
+    }
+
+    void addInts(std::vector<section>& sections, uint32_t id, const alignedIntVector& values) {
+        if (!values.empty()) sections.push_back({id, values.data(), values.size() * sizeof(int32_t)});
+    }
+
+    // All components of a stream, or an empty stream
+    void readStreams(const sectionFile::reader& reader, uint32_t stream, size_t n, particleStreams& streams) {
+        uint32_t id = streamBase + 4 * stream;
+        bool complete = reader.readArray(id, n, streams.x) && reader.readArray(id + 1, n, streams.y);
+#ifdef DYANTRA_PARTICLE_Z
+        if (complete && !reader.readArray(id + 2, n, streams.z)) {
+            streams.z.assign(n, 0.0f);     // written by a planar build
+        }
+#endif
+        if (!complete) streams.resize(0);
+    }
+}
+
+bool simulationSnapshot::save(const std::string& path) const {
+    size_t n = particles.positions.size();
+    std::vector<section> sections;
+    addStreams(sections, 0, particles.positions);
+    addStreams(sections, 1, particles.v);
+    addStreams(sections, 2, particles.f);
+    addStreams(sections, 3, particles.last_positions);
+    addStreams(sections, 4, particles.last_f);
+    addInts(sections, latticeX, particles.latticeX);
+    addInts(sections, latticeY, particles.latticeY);
+    addInts(sections, latticeVx, particles.latticeVx);
+    addInts(sections, latticeVy, particles.latticeVy);
+
+    scheduleRecord scheduleData;
+    scheduleData.timestep = schedule.timestep;
+    scheduleData.reversalActive = schedule.reversalActive;
+    scheduleData.reversalTimestep = schedule.reversalTimestep;
+    scheduleData.nTimeReversalSteps = schedule.nTimeReversalSteps;
+    scheduleData.elapsedTimesteps = schedule.elapsedTimesteps;
+    scheduleData.timeForward = schedule.timeForward;
+    scheduleData.timeReversalInProgress = schedule.timeReversalInProgress;
+    scheduleData.timeReversalStepCounter = schedule.timeReversalStepCounter;
+    scheduleData.nTimeReversalCalls = schedule.nTimeReversalCalls;
+    scheduleData.lastTimeStep = schedule.last_timeStep;
+    scheduleData.originalTimeStep = schedule.originalTimeStep;
+    sections.push_back({scheduleSection, &scheduleData, sizeof(scheduleData)});
+
+    forceRecord forceData = {forceAccuracy == forceKernelAccuracy::fast ? 1 : 0, forceGridThreshold, forceGridTolerance,
+                             attractorCutoff};
+    sections.push_back({forceSection, &forceData, sizeof(forceData)});
+
+    std::vector<float> attractorData;
+    attractorData.reserve(attractors.size() * 4);
+    for (const auto& a : attractors) {
+        attractorData.insert(attractorData.end(), {a.getCenter().x, a.getCenter().y, a.getRadius(), a.getAmplitude()});
+    }
+    sections.push_back({attractorSection, attractorData.data(), attractorData.size() * sizeof(float)});
+
+    // skeleton: points, and the path ID of each as an index into a table of labels
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "skeleton points are written as packed float triples");
+    std::vector<uint32_t> pathIndices;
+    std::string pathLabels;
+    sectionFile::encodeStrings(skeleton.pathIDs, pathIndices, pathLabels);
+    transformRecord transform = {skeleton.requestedPoints,
+                                 {skeleton.midpoint.x, skeleton.midpoint.y, skeleton.midpoint.z},
+                                 {skeleton.translation.x, skeleton.translation.y, skeleton.translation.z},
+                                 skeleton.scale, skeleton.rotation};
+    sections.push_back({skeletonPoints, skeleton.points.data(), skeleton.points.size() * sizeof(glm::vec3)});
+    sections.push_back({skeletonPathIndices, pathIndices.data(), pathIndices.size() * sizeof(uint32_t)});
+    sections.push_back({skeletonPathLabels, pathLabels.data(), pathLabels.size()});
+    sections.push_back({skeletonFile, skeleton.fileName.data(), skeleton.fileName.size()});
+    sections.push_back({skeletonTransform, &transform, sizeof(transform)});
+
+    fileHeader header = {};
+    std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = snapshotVersion;
+    header.byteOrder = sectionFile::byteOrderMark;
+    header.nParticles = n;
+    header.integrator = uint32_t(particles.integrator);
+    header.latticeFlags = (particles.latticeSynced ? 1 : 0) | (particles.latticeForcesValid ? 2 : 0)
+                          | (particles.forcesValid ? 0 : 4);
+    header.boundaryWidth = boundaryWidth;
+    header.boundaryHeight = boundaryHeight;
+    header.nSections = uint32_t(sections.size());
+    return sectionFile::write(path, &header, sizeof(header), sections);
+}
+
+bool simulationSnapshot::load(const std::string& path) {
+    mappedFile file;
+    if (!file.open(path)) {
+        ofLogError("snapshot") << "Unable to open " << path;
+        return false;
+    }
+    sectionFile::reader reader;
+    fileHeader header;
+    if (!reader.readHeader(file, header) || std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0
+        || header.version != snapshotVersion || header.byteOrder != sectionFile::byteOrderMark
+        || !reader.readTable(header.nSections)) {
+        ofLogError("snapshot") << path << " is not a snapshot this version can read";
+        return false;
+    }
+    size_t n = size_t(header.nParticles);
+
+    readStreams(reader, 0, n, particles.positions);
+    readStreams(reader, 1, n, particles.v);
+    readStreams(reader, 2, n, particles.f);
+    readStreams(reader, 3, n, particles.last_positions);
+    readStreams(reader, 4, n, particles.last_f);
+    if (particles.positions.size() != n || particles.v.size() != n || particles.f.size() != n) {
+        ofLogError("snapshot") << path << " has no complete particle state";
+        return false;
+    }
+    reader.readArray(latticeX, n, particles.latticeX);
+    reader.readArray(latticeY, n, particles.latticeY);
+    reader.readArray(latticeVx, n, particles.latticeVx);
+    reader.readArray(latticeVy, n, particles.latticeVy);
+    if (header.integrator > uint32_t(integratorMode::fixedPointVerlet)) {
+        ofLogError("snapshot") << path << " uses an unknown integrator";
+        return false;
+    }
+    particles.integrator = integratorMode(header.integrator);
+    bool hasLattice = particles.latticeX.size() == n && particles.latticeY.size() == n
+                      && particles.latticeVx.size() == n && particles.latticeVy.size() == n;
+    particles.latticeSynced = hasLattice && (header.latticeFlags & 1);
+    particles.latticeForcesValid = hasLattice && (header.latticeFlags & 2);
+    particles.forcesValid = !(header.latticeFlags & 4);
+    boundaryWidth = header.boundaryWidth;
+    boundaryHeight = header.boundaryHeight;
+
+    scheduleRecord scheduleData;
+    if (!reader.readRecord(scheduleSection, scheduleData)) {
+        ofLogError("snapshot") << path << " has no timestep schedule";
+        return false;
+    }
+    schedule.timestep = scheduleData.timestep;
+    schedule.reversalActive = scheduleData.reversalActive != 0;
+    schedule.reversalTimestep = scheduleData.reversalTimestep;
+    schedule.nTimeReversalSteps = scheduleData.nTimeReversalSteps;
+    schedule.elapsedTimesteps = scheduleData.elapsedTimesteps;
+    schedule.timeForward = scheduleData.timeForward != 0;
+    schedule.timeReversalInProgress = scheduleData.timeReversalInProgress != 0;
+    schedule.timeReversalStepCounter = scheduleData.timeReversalStepCounter;
+    schedule.nTimeReversalCalls = scheduleData.nTimeReversalCalls;
+    schedule.last_timeStep = scheduleData.lastTimeStep;
+    schedule.originalTimeStep = scheduleData.originalTimeStep;
+
+    forceRecord forceData;
+    hasForceSettings = reader.readRecord(forceSection, forceData);
+    if (hasForceSettings) {
+        forceAccuracy = forceData.fastExp ? forceKernelAccuracy::fast : forceKernelAccuracy::exact;
+        forceGridThreshold = forceData.forceGridThreshold;
+        forceGridTolerance = forceData.forceGridTolerance;
+        attractorCutoff = forceData.attractorCutoff;
+    }
+
+    uint64_t bytes;
+    const float* attractorData = reinterpret_cast<const float*>(reader.find(attractorSection, bytes));
+    attractors.clear();
+    for (size_t i = 0; i + 4 <= bytes / sizeof(float); i += 4) {
+        attractor a(ofPoint(attractorData[i], attractorData[i + 1]), attractorData[i + 2]);
+        a.setAmplitude(attractorData[i + 3]);
+        attractors.push_back(a);
+    }
+
+    const unsigned char* p = reader.find(skeletonPoints, bytes);
+    size_t nPoints = size_t(bytes / sizeof(glm::vec3));
+    skeleton.points.resize(nPoints);
+    if (nPoints > 0) std::memcpy(skeleton.points.data(), p, nPoints * sizeof(glm::vec3));
+
+    p = reader.find(skeletonPathLabels, bytes);
+    std::vector<std::string> labels = sectionFile::decodeTable(p, bytes);
+    std::vector<uint32_t> pathIndices;
+    reader.readArray(skeletonPathIndices, nPoints, pathIndices);
+    skeleton.pathIDs.clear();
+    for (uint32_t index : pathIndices) {
+        skeleton.pathIDs.push_back(index < labels.size() ? labels[index] : std::string());
+    }
+
+    skeleton.fileName = reader.readString(skeletonFile);
+
+    transformRecord transform;
+    if (reader.readRecord(skeletonTransform, transform)) {
+        skeleton.requestedPoints = transform.requestedPoints;
+        skeleton.midpoint.set(transform.midpoint[0], transform.midpoint[1], transform.midpoint[2]);
+        skeleton.translation.set(transform.translation[0], transform.translation[1], transform.translation[2]);
+        skeleton.scale = transform.scale;
+        skeleton.rotation = transform.rotation;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "ofMain.h"
+#include "attractor.h"
+#include "particleEnsemble.h"
+#include "svgSkeleton.h"
+#include "timeReversalSchedule.h"
+
+// Binary snapshot of a run (.dysnap): particle state, timestep schedule, force settings, attractors and skeleton, so a session picks
+// up mid-run without reading the SVG, resampling it or integrating up to where it was.
+//
+// Stored as sections (see sectionFile.h): loading maps the file and copies each array out in one go.
+struct simulationSnapshot {
+    static const char* extension() { return "dysnap"; }
+
+    particleState particles;
+    timeReversalSchedule schedule;
+    std::vector<attractor> attractors;
+    skeletonState skeleton;
+    float boundaryWidth = 0;
+    float boundaryHeight = 0;
+
+    // particleEnsemble settings the forces depend on; older files have none, hasForceSettings is false then
+    bool hasForceSettings = false;
+    forceKernelAccuracy forceAccuracy = forceKernelAccuracy::exact;
+    int forceGridThreshold = 32;
+    float forceGridTolerance = 1e-3f;
+    float attractorCutoff = 0.0f;
+
+    bool save(const std::string& path) const;   // full paths, see ofToDataPath
+    bool load(const std::string& path);
+};
@@ -0,0 +1,90 @@
+#include "simulationThread.h"
+#include "traceRecorder.h"
+#include <chrono>
+
+void simulationThread::start(std::function<bool()> stepFunction) {
+    stop();
+    step = stepFunction;
+    stopping = false;
+    stepCount = 0;
+    thread = std::thread(&simulationThread::run, this);
+}
+
+void simulationThread::stop() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    thread.join();
+}
+
+std::unique_lock<std::mutex> simulationThread::lockState() {
+    {
+        std::lock_guard<std::mutex> wake(wakeMutex);
+        ++waiters;
+    }
+    std::unique_lock<std::mutex> lock(stateMutex);
+    bool last;
+    {
+        std::lock_guard<std::mutex> wake(wakeMutex);
+        last = --waiters == 0;
+    }
+    if (last) wakeCondition.notify_all();
+    return lock;
+}
+
+void simulationThread::setPlaying(bool play) {
+    if (playing == play) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        playing = play;
+    }
+    wakeCondition.notify_all();
+}
+
+void simulationThread::run() {
+    traceRecorder::setThreadName("simulation");
+    typedef std::chrono::steady_clock clock;
+    clock::time_point nextStep = clock::now();
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            if (!playing) {
+                wakeCondition.wait(lock, [&] { return stopping || playing; });
+                nextStep = clock::now();
+            }
+            // std::mutex is not fair, so back off while the main thread waits for the state
+            wakeCondition.wait(lock, [&] { return stopping || waiters == 0; });
+            if (stopping) return;
+        }
+
+        bool stepped;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (!playing) continue;     // paused while waiting for the lock
+            stepped = step();
+        }
+        if (!stepped) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            nextStep = clock::now();
+            continue;
+        }
+        ++stepCount;
+
+        int stepsPerSecond = rate;
+        if (stepsPerSecond > 0) {
+            nextStep += std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / stepsPerSecond));
+            clock::time_point now = clock::now();
+            if (nextStep < now - std::chrono::milliseconds(100)) {
+                nextStep = now;     // far behind (slow steps, a stall): carry on from here rather than race to catch up
+            }
+            else {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                wakeCondition.wait_until(lock, nextStep, [&] { return stopping || !playing; });
+            }
+        }
+    }
+}
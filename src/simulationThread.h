@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs the integrator on its own thread, so the step rate no longer follows the frame rate: a slow draw (potential
+// field, GUI) does not slow the physics down, and on a fast machine the physics can run well above 60 Hz.
+// The step function runs under the state lock; the main thread takes the same lock (lockState) whenever it reads or
+// changes what a step uses. Positions go back to the renderer through particleEnsemble::publishPositions.
+class simulationThread {
+public:
+    simulationThread() {}
+    ~simulationThread() { stop(); }
+
+    simulationThread(const simulationThread&) = delete;
+    simulationThread& operator=(const simulationThread&) = delete;
+
+    // step returns false when it had nothing to do (e.g. a step budget ran out); the thread then idles briefly
+    void start(std::function<bool()> step);
+    void stop();
+    bool isRunning() const { return thread.joinable(); }
+
+    // Waits for the step in progress, and keeps the thread from starting another until the lock is released
+    std::unique_lock<std::mutex> lockState();
+
+    void setPlaying(bool playing);
+    bool isPlaying() const { return playing; }
+
+    void setRate(int stepsPerSecond) { rate = stepsPerSecond; }    // 0 = as fast as possible
+    int getRate() const { return rate; }
+
+    long long getStepCount() const { return stepCount; }   // steps taken since start()
+
+private:
+    void run();
+
+    std::thread thread;
+    std::function<bool()> step;
+
+    std::mutex stateMutex;
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    bool stopping = false;          // guarded by wakeMutex
+    int waiters = 0;                // guarded by wakeMutex: lockState calls waiting for the state, the step loop lets them in first
+
+    std::atomic<bool> playing{false};
+    std::atomic<int> rate{60};
+    std::atomic<long long> stepCount{0};
+};
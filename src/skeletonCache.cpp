@@ -0,0 +1,117 @@
+#include "skeletonCache.h"
+
+namespace {
+    size_t svgBytes(const svgDocument& document) {
+        size_t bytes = sizeof(document);
+        for (const auto& label : document.pathLabels) bytes += sizeof(label) + label.capacity();
+        for (const auto& outline : document.outlines) {
+            bytes += sizeof(outline) + outline.getVertices().size() * sizeof(glm::vec3);
+        }
+        return bytes;
+    }
+}
+
+size_t skeletonCache::resampledPoints::bytes() const {
+    size_t total = sizeof(*this) + points.size() * sizeof(glm::vec3) + pathIDs.size() * sizeof(std::string);
+    for (const auto& vertices : pathVertices) total += sizeof(vertices) + vertices.size() * sizeof(glm::vec3);
+    for (const auto& indices : pathVerticesIndices) total += sizeof(indices) + indices.size() * sizeof(int);
+    return total;
+}
+
+skeletonCache& skeletonCache::shared() {
+    static skeletonCache cache;
+    return cache;
+}
+
+uint64_t skeletonCache::hashFile(const std::string& filename) {
+    ofFile file(filename);
+    if (!file.exists()) return 0;
+    ofBuffer buffer = file.readToBuffer();
+    if (buffer.size() == 0) return 0;
+
+    // FNV-1a, with the length mixed in
+    uint64_t hash = 14695981039346656037ull;
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(buffer.getData());
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    hash = (hash ^ buffer.size()) * 1099511628211ull;
+    return hash == 0 ? 1 : hash;
+}
+
+void skeletonCache::setBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = bytes;
+    enforceBudget();
+}
+
+std::shared_ptr<const svgDocument> skeletonCache::findSvg(uint64_t hash) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entry* found = find(key(hash, -1));
+    return found ? found->svg : nullptr;
+}
+
+void skeletonCache::addSvg(uint64_t hash, std::shared_ptr<const svgDocument> svg) {
+    size_t bytes = svgBytes(*svg);
+    std::lock_guard<std::mutex> lock(mutex);
+    add(entry{key(hash, -1), std::move(svg), nullptr, bytes});
+}
+
+std::shared_ptr<const skeletonCache::resampledPoints> skeletonCache::findPoints(uint64_t hash, int numPoints) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entry* found = find(key(hash, numPoints));
+    return found ? found->points : nullptr;
+}
+
+void skeletonCache::addPoints(uint64_t hash, int numPoints, std::shared_ptr<const resampledPoints> points) {
+    size_t bytes = points->bytes();
+    std::lock_guard<std::mutex> lock(mutex);
+    add(entry{key(hash, numPoints), nullptr, std::move(points), bytes});
+}
+
+void skeletonCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    used = 0;
+}
+
+size_t skeletonCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+size_t skeletonCache::bytesUsed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return used;
+}
+
+void skeletonCache::add(entry newEntry) {
+    if (newEntry.bytes > budget) return;    // would only push everything else out
+    auto existing = index.find(newEntry.id);
+    if (existing != index.end()) {
+        used -= existing->second->bytes;
+        entries.erase(existing->second);
+        index.erase(existing);
+    }
+    used += newEntry.bytes;
+    entries.push_front(std::move(newEntry));
+    index[entries.front().id] = entries.begin();
+    enforceBudget();
+}
+
+skeletonCache::entry* skeletonCache::find(const key& id) {
+    if (id.first == 0) return nullptr;
+    auto found = index.find(id);
+    if (found == index.end()) return nullptr;
+    entries.splice(entries.begin(), entries, found->second);   // now the most recently used; iterators stay valid
+    return &entries.front();
+}
+
+void skeletonCache::enforceBudget() {
+    while (used > budget && !entries.empty()) {
+        used -= entries.back().bytes;
+        index.erase(entries.back().id);
+        entries.pop_back();
+    }
+}
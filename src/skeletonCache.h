@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "ofMain.h"
+#include "svgLoader.h"
+
+// Parsed SVGs and the points svgSkeleton resampled from them, so loading a file again (the next step of a sequence,
+// a change of the point count and back) skips the parse and the resampling.
+// Entries are keyed by a hash of the file contents, so an edited file is read again under the same name, and the
+// least recently used ones go when the total outgrows the memory budget. The points are stored before the skeleton's
+// translation, scale and rotation, which svgSkeleton applies to its own copy.
+class skeletonCache {
+public:
+    struct resampledPoints {
+        std::vector<glm::vec3> points;      // without the midpoint
+        std::vector<std::string> pathIDs;
+        std::vector<std::vector<glm::vec3>> pathVertices;
+        std::vector<std::vector<int>> pathVerticesIndices;
+        size_t bytes() const;
+    };
+
+    static skeletonCache& shared();     // the one svgSkeleton uses
+    static uint64_t hashFile(const std::string& filename);  // of the contents; 0 if the file cannot be read
+
+    void setBudget(size_t bytes);       // 0 = keep nothing
+    size_t getBudget() const { return budget; }
+
+    std::shared_ptr<const svgDocument> findSvg(uint64_t hash);
+    void addSvg(uint64_t hash, std::shared_ptr<const svgDocument> svg);
+    std::shared_ptr<const resampledPoints> findPoints(uint64_t hash, int numPoints);
+    void addPoints(uint64_t hash, int numPoints, std::shared_ptr<const resampledPoints> points);
+
+    void clear();
+    size_t size() const;
+    size_t bytesUsed() const;
+
+private:
+    typedef std::pair<uint64_t, int> key;  // file hash and point count; point count -1 is the parsed SVG
+
+    struct entry {
+        key id;
+        std::shared_ptr<const svgDocument> svg;
+        std::shared_ptr<const resampledPoints> points;
+        size_t bytes;
+    };
+
+    void add(entry newEntry);
+    entry* find(const key& id);
+    void enforceBudget();
+
+    size_t budget = size_t(256) << 20;
+    size_t used = 0;
+    std::list<entry> entries;   // most recently used first
+    std::map<key, std::list<entry>::iterator> index;
+    mutable std::mutex mutex;
+};
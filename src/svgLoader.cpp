@@ -0,0 +1,648 @@
+#include "svgLoader.h"
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include "mappedFile.h"
+#include "traceRecorder.h"
+
+namespace {
+    const float kappa = 0.5522847498f;     // control point distance of a quarter circle, as in svgtiny
+
+    // x' = a x + c y + e, y' = b x + d y + f
+    struct affine {
+        float a = 1, b = 0, c = 0, d = 1, e = 0, f = 0;
+
+        glm::vec3 apply(float x, float y) const {
+            return glm::vec3(a * x + c * y + e, b * x + d * y + f, 0);
+        }
+        // this after m
+        affine operator*(const affine& m) const {
+            affine r;
+            r.a = a * m.a + c * m.b;
+            r.b = b * m.a + d * m.b;
+            r.c = a * m.c + c * m.d;
+            r.d = b * m.c + d * m.d;
+            r.e = a * m.e + c * m.f + e;
+            r.f = b * m.e + d * m.f + f;
+            return r;
+        }
+    };
+
+    affine translation(float x, float y) { affine t; t.e = x; t.f = y; return t; }
+
+    // A start tag's attributes, pointing into the text
+    struct attributeList {
+        struct attribute {
+            const char* name;
+            size_t nameLength;
+            const char* value;
+            size_t valueLength;
+        };
+        std::vector<attribute> list;
+
+        bool get(const char* name, const char*& value, const char*& valueEnd) const {
+            size_t length = std::strlen(name);
+            for (const auto& attr : list) {
+                if (attr.nameLength == length && std::memcmp(attr.name, name, length) == 0) {
+                    value = attr.value;
+                    valueEnd = attr.value + attr.valueLength;
+                    return true;
+                }
+            }
+            return false;
+        }
+        std::string get(const char* name) const {
+            const char* value;
+            const char* valueEnd;
+            return get(name, value, valueEnd) ? std::string(value, valueEnd) : std::string();
+        }
+    };
+
+    bool isSpace(char ch) { return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r'; }
+
+    void skipSeparators(const char*& s, const char* end) {
+        while (s < end && (isSpace(*s) || *s == ',')) ++s;
+    }
+
+    // A number in SVG syntax ("-.5e2", and "1.5.5" is two numbers); locale independent, unlike strtof
+    bool readNumber(const char*& s, const char* end, float& value) {
+        skipSeparators(s, end);
+        const char* p = s;
+        bool negative = false;
+        if (p < end && (*p == '+' || *p == '-')) negative = *p++ == '-';
+        double number = 0;
+        bool digits = false;
+        while (p < end && *p >= '0' && *p <= '9') { number = number * 10 + (*p++ - '0'); digits = true; }
+        if (p < end && *p == '.') {
+            ++p;
+            double scale = 0.1;
+            while (p < end && *p >= '0' && *p <= '9') { number += (*p++ - '0') * scale; scale *= 0.1; digits = true; }
+        }
+        if (!digits) return false;
+        if (p < end && (*p == 'e' || *p == 'E') && p + 1 < end) {
+            const char* q = p + 1;
+            bool negativeExponent = false;
+            if (*q == '+' || *q == '-') negativeExponent = *q++ == '-';
+            if (q < end && *q >= '0' && *q <= '9') {
+                int exponent = 0;
+                while (q < end && *q >= '0' && *q <= '9') exponent = exponent * 10 + (*q++ - '0');
+                number *= std::pow(10.0, negativeExponent ? -exponent : exponent);
+                p = q;
+            }
+        }
+        value = float(negative ? -number : number);
+        s = p;
+        return true;
+    }
+
+    // Arc flags may run into the next number ("a5 5 0 01 10 0")
+    bool readFlag(const char*& s, const char* end, bool& flag) {
+        skipSeparators(s, end);
+        if (s >= end || (*s != '0' && *s != '1')) return false;
+        flag = *s++ == '1';
+        return true;
+    }
+
+    // Lengths with units, converted the way svgtiny does (90 dpi)
+    float parseLength(const char* s, const char* end, float viewportSize) {
+        float number;
+        if (!readNumber(s, end, number)) return 0;
+        std::string unit(s, end);
+        if (unit.empty() || unit == "px") return number;
+        if (unit == "%") return number / 100.0f * viewportSize;
+        if (unit == "em") return number * 20;
+        if (unit == "ex") return number * 10;
+        if (unit == "pt") return number * 1.25f;
+        if (unit == "pc") return number * 15;
+        if (unit == "mm") return number * 3.543307f;
+        if (unit == "cm") return number * 35.43307f;
+        if (unit == "in") return number * 90;
+        return 0;
+    }
+
+    float lengthAttribute(const attributeList& attributes, const char* name, float viewportSize) {
+        const char* value;
+        const char* valueEnd;
+        return attributes.get(name, value, valueEnd) ? parseLength(value, valueEnd, viewportSize) : 0;
+    }
+
+    // transform="matrix(...) translate(...) ...", applied right to left
+    affine parseTransform(const char* s, const char* end) {
+        affine result;
+        while (true) {
+            skipSeparators(s, end);
+            const char* nameStart = s;
+            while (s < end && std::isalpha((unsigned char)*s)) ++s;
+            std::string name(nameStart, s);
+            while (s < end && isSpace(*s)) ++s;
+            if (name.empty() || s >= end || *s != '(') break;
+            ++s;
+            float args[6];
+            int n = 0;
+            while (n < 6 && readNumber(s, end, args[n])) ++n;
+            while (s < end && *s != ')') ++s;
+            if (s < end) ++s;
+
+            affine t;
+            if (name == "matrix" && n == 6) {
+                t.a = args[0]; t.b = args[1]; t.c = args[2]; t.d = args[3]; t.e = args[4]; t.f = args[5];
+            }
+            else if (name == "translate" && n >= 1) {
+                t = translation(args[0], n > 1 ? args[1] : 0);
+            }
+            else if (name == "scale" && n >= 1) {
+                t.a = args[0];
+                t.d = n > 1 ? args[1] : args[0];
+            }
+            else if (name == "rotate" && n >= 1) {
+                float angle = ofDegToRad(args[0]);
+                t.a = std::cos(angle); t.b = std::sin(angle); t.c = -t.b; t.d = t.a;
+                if (n >= 3) t = translation(args[1], args[2]) * t * translation(-args[1], -args[2]);
+            }
+            else if (name == "skewX" && n >= 1) {
+                t.c = std::tan(ofDegToRad(args[0]));
+            }
+            else if (name == "skewY" && n >= 1) {
+                t.b = std::tan(ofDegToRad(args[0]));
+            }
+            result = result * t;
+        }
+        return result;
+    }
+
+    // Turns path commands into outlines the way ofPath::generatePolylinesFromCommands does: a polyline per
+    // subpath, lines as vertices, cubic curves in curveResolution steps
+    class outlineBuilder {
+    public:
+        outlineBuilder(std::vector<ofPolyline>& outlines, const affine& ctm) : outlines(outlines), ctm(ctm) {}
+        ~outlineBuilder() { finish(); }
+
+        void moveTo(float x, float y) {
+            finish();
+            current.addVertex(ctm.apply(x, y));
+        }
+        void lineTo(float x, float y) {
+            current.addVertex(ctm.apply(x, y));
+        }
+        // as ofPolyline::bezierTo, from the last vertex
+        void bezierTo(float x1, float y1, float x2, float y2, float x3, float y3) {
+            if (current.size() == 0) return;
+            glm::vec3 p0 = current[int(current.size()) - 1];
+            glm::vec3 p1 = ctm.apply(x1, y1);
+            glm::vec3 p2 = ctm.apply(x2, y2);
+            glm::vec3 p3 = ctm.apply(x3, y3);
+            glm::vec3 c = 3.0f * (p1 - p0);
+            glm::vec3 b = 3.0f * (p2 - p1) - c;
+            glm::vec3 a = p3 - p0 - c - b;
+            for (int i = 1; i <= svgLoader::curveResolution; i++) {
+                float t = float(i) / float(svgLoader::curveResolution);
+                float t2 = t * t;
+                float t3 = t2 * t;
+                current.addVertex(a * t3 + b * t2 + c * t + p0);
+            }
+        }
+        void close() {
+            current.setClosed(true);
+            finish();
+        }
+        void finish() {
+            if (current.size() >= 2) outlines.push_back(std::move(current));   // a lone moveto draws nothing
+            current = ofPolyline();
+        }
+
+    private:
+        std::vector<ofPolyline>& outlines;
+        affine ctm;
+        ofPolyline current;
+    };
+
+    // Elliptical arc as cubic curves of at most 90 degrees each (SVG implementation notes, F.6.5)
+    void arcTo(outlineBuilder& builder, float x0, float y0, float rx, float ry, float xAxisRotation,
+               bool largeArc, bool sweep, float x, float y) {
+        if (x0 == x && y0 == y) return;
+        rx = std::abs(rx);
+        ry = std::abs(ry);
+        if (rx == 0 || ry == 0) {
+            builder.lineTo(x, y);
+            return;
+        }
+        double phi = ofDegToRad(xAxisRotation);
+        double cosPhi = std::cos(phi), sinPhi = std::sin(phi);
+        double dx = (x0 - x) / 2.0, dy = (y0 - y) / 2.0;
+        double x1 = cosPhi * dx + sinPhi * dy;
+        double y1 = -sinPhi * dx + cosPhi * dy;
+
+        double lambda = (x1 * x1) / (rx * rx) + (y1 * y1) / (ry * ry);
+        if (lambda > 1) {
+            rx *= std::sqrt(lambda);
+            ry *= std::sqrt(lambda);
+        }
+        double rx2 = double(rx) * rx, ry2 = double(ry) * ry;
+        double numerator = rx2 * ry2 - rx2 * y1 * y1 - ry2 * x1 * x1;
+        double denominator = rx2 * y1 * y1 + ry2 * x1 * x1;
+        double coefficient = std::sqrt(std::max(0.0, numerator / denominator)) * (largeArc == sweep ? -1 : 1);
+        double cx1 = coefficient * rx * y1 / ry;
+        double cy1 = -coefficient * ry * x1 / rx;
+        double cx = cosPhi * cx1 - sinPhi * cy1 + (x0 + x) / 2.0;
+        double cy = sinPhi * cx1 + cosPhi * cy1 + (y0 + y) / 2.0;
+
+        auto angle = [](double ux, double uy, double vx, double vy) {
+            return std::atan2(ux * vy - uy * vx, ux * vx + uy * vy);
+        };
+        double theta = angle(1, 0, (x1 - cx1) / rx, (y1 - cy1) / ry);
+        double delta = angle((x1 - cx1) / rx, (y1 - cy1) / ry, (-x1 - cx1) / rx, (-y1 - cy1) / ry);
+        if (!sweep && delta > 0) delta -= TWO_PI;
+        if (sweep && delta < 0) delta += TWO_PI;
+
+        int segments = std::max(1, int(std::ceil(std::abs(delta) / HALF_PI - 1e-6)));
+        double step = delta / segments;
+        double handle = 4.0 / 3.0 * std::tan(step / 4);
+        auto point = [&](double t, double& px, double& py) {
+            px = cx + rx * std::cos(t) * cosPhi - ry * std::sin(t) * sinPhi;
+            py = cy + rx * std::cos(t) * sinPhi + ry * std::sin(t) * cosPhi;
+        };
+        auto derivative = [&](double t, double& px, double& py) {
+            px = -rx * std::sin(t) * cosPhi - ry * std::cos(t) * sinPhi;
+            py = -rx * std::sin(t) * sinPhi + ry * std::cos(t) * cosPhi;
+        };
+        for (int i = 0; i < segments; ++i) {
+            double t0 = theta + i * step, t1 = t0 + step;
+            double ax, ay, bx, by, dax, day, dbx, dby;
+            point(t0, ax, ay);
+            point(t1, bx, by);
+            derivative(t0, dax, day);
+            derivative(t1, dbx, dby);
+            if (i == segments - 1) { bx = x; by = y; }
+            builder.bezierTo(float(ax + handle * dax), float(ay + handle * day),
+                             float(bx - handle * dbx), float(by - handle * dby), float(bx), float(by));
+        }
+    }
+
+    void addPath(const char* s, const char* end, outlineBuilder& builder) {
+        char command = 0;
+        float x = 0, y = 0;                 // current point
+        float startX = 0, startY = 0;       // of the subpath
+        float cubicX = 0, cubicY = 0;       // last cubic control point, for S
+        float quadX = 0, quadY = 0;         // last quadratic control point, for T
+        char previous = 0;
+        bool open = false;                  // a subpath is being drawn
+
+        while (true) {
+            skipSeparators(s, end);
+            if (s >= end) break;
+            if (std::isalpha((unsigned char)*s)) {
+                command = *s++;
+                if (command == 'z' || command == 'Z') {
+                    if (open) builder.close();
+                    open = false;
+                    x = startX;
+                    y = startY;
+                    previous = command;
+                    continue;
+                }
+            }
+            else if (command == 0 || command == 'z' || command == 'Z') {
+                break;  // numbers without a command
+            }
+
+            bool relative = std::islower((unsigned char)command);
+            float ox = relative ? x : 0, oy = relative ? y : 0;
+            char type = char(std::toupper((unsigned char)command));
+            if (type != 'M' && !open) {
+                builder.moveTo(x, y);   // drawing on after a closepath starts from the subpath's start
+                open = true;
+            }
+
+            float v[7];
+            bool ok = true;
+            switch (type) {
+            case 'M':
+                ok = readNumber(s, end, v[0]) && readNumber(s, end, v[1]);
+                if (!ok) break;
+                x = ox + v[0];
+                y = oy + v[1];
+                startX = x;
+                startY = y;
+                builder.moveTo(x, y);
+                open = true;
+                command = relative ? 'l' : 'L';     // further pairs are lines
+                break;
+            case 'L':
+                ok = readNumber(s, end, v[0]) && readNumber(s, end, v[1]);
+                if (!ok) break;
+                x = ox + v[0];
+                y = oy + v[1];
+                builder.lineTo(x, y);
+                break;
+            case 'H':
+                ok = readNumber(s, end, v[0]);
+                if (!ok) break;
+                x = ox + v[0];
+                builder.lineTo(x, y);
+                break;
+            case 'V':
+                ok = readNumber(s, end, v[0]);
+                if (!ok) break;
+                y = oy + v[0];
+                builder.lineTo(x, y);
+                break;
+            case 'C':
+                for (int i = 0; i < 6 && ok; ++i) ok = readNumber(s, end, v[i]);
+                if (!ok) break;
+                builder.bezierTo(ox + v[0], oy + v[1], ox + v[2], oy + v[3], ox + v[4], oy + v[5]);
+                cubicX = ox + v[2];
+                cubicY = oy + v[3];
+                x = ox + v[4];
+                y = oy + v[5];
+                break;
+            case 'S': {
+                for (int i = 0; i < 4 && ok; ++i) ok = readNumber(s, end, v[i]);
+                if (!ok) break;
+                bool reflect = previous == 'C' || previous == 'S';
+                float x1 = reflect ? 2 * x - cubicX : x;
+                float y1 = reflect ? 2 * y - cubicY : y;
+                builder.bezierTo(x1, y1, ox + v[0], oy + v[1], ox + v[2], oy + v[3]);
+                cubicX = ox + v[0];
+                cubicY = oy + v[1];
+                x = ox + v[2];
+                y = oy + v[3];
+                break;
+            }
+            case 'Q':
+            case 'T': {
+                float qx, qy;
+                if (type == 'Q') {
+                    for (int i = 0; i < 4 && ok; ++i) ok = readNumber(s, end, v[i]);
+                    if (!ok) break;
+                    qx = ox + v[0];
+                    qy = oy + v[1];
+                    v[0] = v[2];
+                    v[1] = v[3];
+                }
+                else {
+                    ok = readNumber(s, end, v[0]) && readNumber(s, end, v[1]);
+                    if (!ok) break;
+                    bool reflect = previous == 'Q' || previous == 'T';
+                    qx = reflect ? 2 * x - quadX : x;
+                    qy = reflect ? 2 * y - quadY : y;
+                }
+                float x3 = ox + v[0], y3 = oy + v[1];
+                builder.bezierTo(x + 2.0f / 3.0f * (qx - x), y + 2.0f / 3.0f * (qy - y),
+                                 x3 + 2.0f / 3.0f * (qx - x3), y3 + 2.0f / 3.0f * (qy - y3), x3, y3);
+                quadX = qx;
+                quadY = qy;
+                x = x3;
+                y = y3;
+                break;
+            }
+            case 'A': {
+                bool largeArc = false, sweep = false;
+                ok = readNumber(s, end, v[0]) && readNumber(s, end, v[1]) && readNumber(s, end, v[2]) &&
+                     readFlag(s, end, largeArc) && readFlag(s, end, sweep) &&
+                     readNumber(s, end, v[3]) && readNumber(s, end, v[4]);
+                if (!ok) break;
+                arcTo(builder, x, y, v[0], v[1], v[2], largeArc, sweep, ox + v[3], oy + v[4]);
+                x = ox + v[3];
+                y = oy + v[4];
+                break;
+            }
+            default:
+                ok = false;
+            }
+            if (!ok) break;     // malformed data: keep what came before, as svgtiny does
+            previous = type;
+        }
+    }
+
+    void addEllipse(outlineBuilder& builder, float x, float y, float rx, float ry) {
+        if (rx <= 0 || ry <= 0) return;
+        builder.moveTo(x + rx, y);
+        builder.bezierTo(x + rx, y + ry * kappa, x + rx * kappa, y + ry, x, y + ry);
+        builder.bezierTo(x - rx * kappa, y + ry, x - rx, y + ry * kappa, x - rx, y);
+        builder.bezierTo(x - rx, y - ry * kappa, x - rx * kappa, y - ry, x, y - ry);
+        builder.bezierTo(x + rx * kappa, y - ry, x + rx, y - ry * kappa, x + rx, y);
+        builder.close();
+    }
+
+    class svgParser {
+    public:
+        explicit svgParser(svgDocument& document) : document(document) {}
+
+        bool parse(const char* s, const char* end) {
+            while (s < end) {
+                const char* open = static_cast<const char*>(std::memchr(s, '<', end - s));
+                if (!open) break;
+                s = open + 1;
+                if (startsWith(s, end, "!--")) {
+                    s = skipPast(s + 3, end, "-->");
+                }
+                else if (startsWith(s, end, "![CDATA[")) {
+                    s = skipPast(s, end, "]]>");
+                }
+                else if (*s == '?') {
+                    s = skipPast(s, end, "?>");
+                }
+                else if (*s == '!') {
+                    s = skipDeclaration(s, end);
+                }
+                else if (*s == '/') {
+                    if (!stack.empty()) stack.pop_back();
+                    s = skipPast(s, end, ">");
+                }
+                else {
+                    s = startTag(s, end);
+                }
+            }
+            return foundSvg;
+        }
+
+    private:
+        struct element {
+            affine ctm;
+            bool geometry;  // shapes inside are drawn
+        };
+
+        static bool startsWith(const char* s, const char* end, const char* prefix) {
+            size_t length = std::strlen(prefix);
+            return size_t(end - s) >= length && std::memcmp(s, prefix, length) == 0;
+        }
+
+        static const char* skipPast(const char* s, const char* end, const char* marker) {
+            size_t length = std::strlen(marker);
+            for (; s + length <= end; ++s) {
+                if (std::memcmp(s, marker, length) == 0) return s + length;
+            }
+            return end;
+        }
+
+        // <!DOCTYPE ...>, which may hold an internal subset in brackets
+        static const char* skipDeclaration(const char* s, const char* end) {
+            int depth = 0;
+            for (; s < end; ++s) {
+                if (*s == '[') depth++;
+                else if (*s == ']') depth--;
+                else if (*s == '>' && depth <= 0) return s + 1;
+            }
+            return end;
+        }
+
+        const char* startTag(const char* s, const char* end) {
+            const char* nameStart = s;
+            while (s < end && !isSpace(*s) && *s != '>' && *s != '/') ++s;
+            std::string name(nameStart, s);
+            if (name.compare(0, 4, "svg:") == 0) name.erase(0, 4);
+
+            attributes.list.clear();
+            bool selfClosing = false;
+            while (s < end) {
+                while (s < end && isSpace(*s)) ++s;
+                if (s >= end) break;
+                if (*s == '>') { ++s; break; }
+                if (*s == '/') { selfClosing = true; ++s; continue; }
+
+                const char* attributeName = s;
+                while (s < end && !isSpace(*s) && *s != '=' && *s != '>' && *s != '/') ++s;
+                size_t attributeNameLength = s - attributeName;
+                while (s < end && isSpace(*s)) ++s;
+                if (s >= end || *s != '=') continue;   // an attribute without a value
+                ++s;
+                while (s < end && isSpace(*s)) ++s;
+                if (s >= end || (*s != '"' && *s != '\'')) continue;
+                char quote = *s++;
+                const char* value = s;
+                while (s < end && *s != quote) ++s;
+                attributes.list.push_back({attributeName, attributeNameLength, value, size_t(s - value)});
+                if (s < end) ++s;
+            }
+
+            element parent = stack.empty() ? element{affine(), false} : stack.back();
+            element current{parent.ctm, false};
+
+            std::string id = attributes.get("id");
+            if (id.find("path") != std::string::npos) document.pathLabels.push_back(id);
+
+            if (name == "svg" && !foundSvg) {
+                current.ctm = rootTransform();
+                current.geometry = true;
+                foundSvg = true;
+            }
+            else if (parent.geometry && (name == "g" || name == "a" || name == "svg")) {
+                current.ctm = parent.ctm * elementTransform();
+                current.geometry = true;
+            }
+            else if (parent.geometry) {
+                outlineBuilder builder(document.outlines, parent.ctm * elementTransform());
+                addShape(name, builder);
+            }
+
+            if (!selfClosing) stack.push_back(current);
+            return s;
+        }
+
+        affine elementTransform() const {
+            const char* value;
+            const char* valueEnd;
+            return attributes.get("transform", value, valueEnd) ? parseTransform(value, valueEnd) : affine();
+        }
+
+        // svgtiny's viewport: width and height in whole pixels, the viewBox scaled to them
+        affine rootTransform() {
+            document.width = float(int(lengthAttribute(attributes, "width", 0)));
+            document.height = float(int(lengthAttribute(attributes, "height", 0)));
+
+            affine ctm;
+            const char* value;
+            const char* valueEnd;
+            float box[4];
+            if (attributes.get("viewBox", value, valueEnd) && readNumber(value, valueEnd, box[0]) &&
+                readNumber(value, valueEnd, box[1]) && readNumber(value, valueEnd, box[2]) &&
+                readNumber(value, valueEnd, box[3]) && box[2] > 0 && box[3] > 0) {
+                // without a size the viewBox is the size
+                if (document.width < 1 && document.height < 1) {
+                    document.width = box[2];
+                    document.height = box[3];
+                }
+                ctm.a = document.width / box[2];
+                ctm.d = document.height / box[3];
+                ctm.e = -box[0] * ctm.a;
+                ctm.f = -box[1] * ctm.d;
+            }
+            viewportWidth = document.width;
+            viewportHeight = document.height;
+            return ctm * elementTransform();
+        }
+
+        void addShape(const std::string& name, outlineBuilder& builder) const {
+            auto length = [&](const char* attribute, float viewportSize) {
+                return lengthAttribute(attributes, attribute, viewportSize);
+            };
+            if (name == "path") {
+                const char* value;
+                const char* valueEnd;
+                if (attributes.get("d", value, valueEnd)) addPath(value, valueEnd, builder);
+            }
+            else if (name == "ellipse") {
+                addEllipse(builder, length("cx", viewportWidth), length("cy", viewportHeight),
+                           length("rx", viewportWidth), length("ry", viewportHeight));
+            }
+            else if (name == "circle") {
+                float r = length("r", viewportWidth);
+                addEllipse(builder, length("cx", viewportWidth), length("cy", viewportHeight), r, r);
+            }
+            else if (name == "rect") {
+                float x = length("x", viewportWidth), y = length("y", viewportHeight);
+                float width = length("width", viewportWidth), height = length("height", viewportHeight);
+                if (width <= 0 || height <= 0) return;
+                builder.moveTo(x, y);
+                builder.lineTo(x + width, y);
+                builder.lineTo(x + width, y + height);
+                builder.lineTo(x, y + height);
+                builder.close();
+            }
+            else if (name == "line") {
+                builder.moveTo(length("x1", viewportWidth), length("y1", viewportHeight));
+                builder.lineTo(length("x2", viewportWidth), length("y2", viewportHeight));
+            }
+            else if (name == "polyline" || name == "polygon") {
+                const char* value;
+                const char* valueEnd;
+                if (!attributes.get("points", value, valueEnd)) return;
+                float px, py;
+                bool first = true;
+                while (readNumber(value, valueEnd, px) && readNumber(value, valueEnd, py)) {
+                    if (first) builder.moveTo(px, py);
+                    else builder.lineTo(px, py);
+                    first = false;
+                }
+                if (name == "polygon") builder.close();
+            }
+        }
+
+        svgDocument& document;
+        std::vector<element> stack;
+        attributeList attributes;   // of the tag being read
+        bool foundSvg = false;
+        float viewportWidth = 0;
+        float viewportHeight = 0;
+    };
+}
+
+bool svgLoader::load(const std::string& filename, svgDocument& document) {
+    traceRecorder::scope trace("svgLoader::load");
+    mappedFile file;
+    if (!file.open(ofToDataPath(filename))) {
+        ofLogError("svgLoader") << "cannot read " << filename;
+        return false;
+    }
+    if (!parse(reinterpret_cast<const char*>(file.getData()), file.getSize(), document)) {
+        ofLogError("svgLoader") << "no <svg> element in " << filename;
+        return false;
+    }
+    return true;
+}
+
+bool svgLoader::parse(const char* text, size_t size, svgDocument& document) {
+    document = svgDocument();
+    svgParser parser(document);
+    return parser.parse(text, text + size);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ofMain.h"
+
+// What svgSkeleton needs from an SVG file: the outline of every subpath and the path IDs
+struct svgDocument {
+    std::vector<ofPolyline> outlines;       // one per subpath, in document order, in pixels
+    std::vector<std::string> pathLabels;    // IDs that contain "path", in document order
+    float width = 0;
+    float height = 0;
+};
+
+// Reads an SVG in one pass over the text, without building a DOM: IDs are collected and shapes are flattened into
+// outlines as their tags go by. The geometry follows ofxSVG (svgtiny underneath), so the outlines are the ones
+// ofPath::getOutline gave for an ofxSVG path in OF_POLY_WINDING_ODD mode:
+//   - path (all commands, arcs as cubic curves), rect, circle, ellipse, line, polyline and polygon, inside svg, g
+//     and a elements; everything else, defs included, holds no geometry
+//   - transform attributes and the root viewBox, with width and height in px, pt, pc, mm, cm or in (90 dpi)
+//   - cubic curves flattened into curveResolution segments, as ofPolyline::bezierTo does
+// pathLabels holds every ID containing 'path', in document order; comments are skipped, never searched for IDs.
+class svgLoader {
+public:
+    static const int curveResolution = 20;  // ofPath's default
+
+    static bool load(const std::string& filename, svgDocument& document);  // false if the file cannot be read
+    static bool parse(const char* text, size_t size, svgDocument& document);   // false without an <svg> element
+};
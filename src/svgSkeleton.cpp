@@ -1,10 +1,15 @@
 #include "svgSkeleton.h"
+#include <cfloat>
 #include <cmath>
 #include <glm/vec3.hpp>
+#include "compiledSkeleton.h"
 #include "ofxXmlSettings.h"
+#include "svgLoader.h"
+#include "traceRecorder.h"
 
 
 void svgSkeleton::loadSvg(const std::string& filename) {
+    traceRecorder::scope trace("loadSvg");
     
     ofFile file(filename);
     if (!file.exists()) {
@@ -13,36 +18,11 @@ void svgSkeleton::loadSvg(const std::string& filename) {
     }
     
     fileName = filename; // Store the file name
-    
-    ofXml xml;
-    if (xml.load(filename)) {
-        polyLineLabels.clear();
-
-        // Ensure we navigate to the <svg> element
-        auto svgElement = xml.findFirst("//svg");
-        if (svgElement) {
-            // Find all elements within the SVG that have an 'id' attribute
-            auto allElementsWithId = svgElement.find("//*[@id]");  // Select any element with an 'id' attribute
-            for (auto& element : allElementsWithId) {
-                // Check if this element is part of a commented block
-                std::string elementContent = element.toString();
-                if (elementContent.find("<!--") == std::string::npos && elementContent.find("-->") == std::string::npos) {
-                    std::string id = element.getAttribute("id").getValue();
-
-                    // Only store IDs that contain the substring 'path'
-                    if (id.find("path") != std::string::npos) {
-                        polyLineLabels.push_back(id);  // Store the ID in the polyLineLabels vector
-                    }
-                }
-            }
-        } else {
-            ofLogError() << "No <svg> element found in the file: " << filename;
-        }
-    } else {
-        ofLogError() << "Failed to load SVG file: " << filename;
+    openFile();
+    if (!compiled) {
+        parsed.reset();
+        parsedFile();   // a hit in skeletonCache unless the contents are new
     }
-    
-    svg.load(filename);
     translation.set(0, 0);
     cumulativeScale = 1.0f;
     svgMidpoint.set(0, 0);
@@ -50,151 +30,202 @@ void svgSkeleton::loadSvg(const std::string& filename) {
     currentRotationAngle = 0.0f; // 45 degrees counterclockwise from vertical
 }
 
-void svgSkeleton::generateEquidistantPoints(int numDesiredPoints) {
-    float totalPathLength = 0;
-    std::vector<std::pair<ofPolyline, float>> polylinesWithLengths;
-    std::vector<glm::vec3> vertices;
-
-    equidistantPoints.clear();  // Clear previous points
-    equidistantPointsPathIDs.clear();  // Clear previous path IDs
-    pathVertices.clear();  // Clear previous path vertices data
-    pathVerticesIndices.clear();
-
-    // Step 1: Calculate the total length of all paths and identify vertices
-    int numPaths = svg.getNumPath();
-    for (int i = 0; i < numPaths; i++) {
-        ofPath path = svg.getPathAt(i);
-        path.setPolyWindingMode(OF_POLY_WINDING_ODD);  // Ensure proper winding mode
-
-        auto polylines = path.getOutline();
-        for (auto& polyline : polylines) {
-            float pathLength = polyline.getPerimeter();
-            totalPathLength += pathLength;
-            polylinesWithLengths.emplace_back(polyline, pathLength);
-            
-            // Prepare a vector to store vertices for the current polyline
-            std::vector<glm::vec3> currentPathVertices;
-            std::vector<int> currentPathVerticesIndices;
-
-            // Identify vertices and order points
-            auto points = polyline.getVertices();
-            for (size_t j = 0; j < points.size(); ++j) {
-                glm::vec3 vertex(points[j].x, points[j].y, points[j].z);
-//                cout << "points[j].x : "  << points[j].x << " points[j].y "  << points[j].y << endl;
-
-                // First and last points are always vertices
-                if (j == 0 || j == points.size() - 1) {
-                    vertices.push_back(vertex);
-                    currentPathVertices.push_back(vertex);
-                    currentPathVerticesIndices.push_back(j);
-                } else {
-                    // Calculate the angle between adjacent segments
-                    glm::vec3 prev(points[j - 1].x - points[j].x, points[j - 1].y - points[j].y, points[j - 1].z - points[j].z);
-                    glm::vec3 next(points[j + 1].x - points[j].x, points[j + 1].y - points[j].y, points[j + 1].z - points[j].z);
-                    float angle = std::acos(glm::dot(glm::normalize(prev), glm::normalize(next)));
-
-                    // If angle is sharp, consider it a vertex
-                    if (angle < glm::radians(170.0f)) {  // Threshold angle can be adjusted
-                        vertices.push_back(vertex);
-                        currentPathVertices.push_back(vertex);
-                        currentPathVerticesIndices.push_back(j);
-                    }
-                }
-            }
-            // if the polyline is a closed path, ensure that the last vertex is identical to the first one
-            size_t lastIdx = currentPathVertices.size() - 1;
-            if(polyline.isClosed() && (currentPathVertices[lastIdx] != currentPathVertices[0])){
-                currentPathVertices.push_back(currentPathVertices[0]);
-            }
-            pathVertices.push_back(currentPathVertices); // Store vertices of the current polyline in pathVertices
-            pathVerticesIndices.push_back(currentPathVerticesIndices);
+// What fileName names: an SVG, or a .dyskel and the SVG it was compiled from
+void svgSkeleton::openFile() {
+    openedFileName = fileName;
+    svgFile = fileName;
+    compiled.reset();
+    hashedFileName.clear();     // the contents may have changed since the last hash
+    if (compiledSkeleton::isCompiledSkeleton(fileName)) {
+        auto skeleton = std::make_shared<compiledSkeleton>();
+        if (skeleton->load(ofToDataPath(fileName))) {
+            svgFile = skeleton->svgFile;
+            compiled = skeleton;
         }
     }
+}
 
-    // Calculate the remaining points needed after vertices are accounted for
-    int remainingPoints = numDesiredPoints - static_cast<int>(vertices.size()) - 1; // -1 to avoid counting centroid
-    if (remainingPoints <= 0) {
-        // If remaining points are zero or less, just return the vertices
-        equidistantPoints.insert(equidistantPoints.end(), vertices.begin(), vertices.end());
-        for (size_t i = 0; i < vertices.size(); ++i) {
-            equidistantPointsPathIDs.push_back(polyLineLabels[0]);  // Assuming all vertices belong to the first path, adjust as needed
+uint64_t svgSkeleton::svgHash() {
+    if (hashedFileName != svgFile) {
+        fileHash = skeletonCache::hashFile(svgFile);
+        hashedFileName = svgFile;
+    }
+    return fileHash;
+}
+
+const svgDocument& svgSkeleton::parsedFile() {
+    if (openedFileName != fileName) {
+        openFile();     // restored from a snapshot
+    }
+    uint64_t hash = svgHash();
+    if (!parsed || parsedHash != hash) {
+        auto& cache = skeletonCache::shared();
+        parsed = hash != 0 ? cache.findSvg(hash) : nullptr;
+        if (!parsed) {
+            auto document = std::make_shared<svgDocument>();
+            svgLoader::load(svgFile, *document);    // logs what went wrong; the skeleton is then empty
+            parsed = document;
+            if (hash != 0) cache.addSvg(hash, parsed);
         }
+        parsedHash = hash;
     }
-    else{
-        
-        float segmentLength = totalPathLength / remainingPoints;
-        
-        for (size_t i = 0; i < polylinesWithLengths.size(); ++i) {
-            ofPolyline& polyline = polylinesWithLengths[i].first;
-            auto& polylineVertices = pathVertices[i]; // get vertices from the pathVertices
-            
-            float lengthAlongPath(0.0);
-            float lengthStep;
-            std::vector<int> currentPathVerticesIndices = pathVerticesIndices[i];
-            
-            for(size_t ii=0; ii< (polylineVertices.size() - 1); ++ii){
-                
-                glm::vec3 startVertex = polylineVertices[ii];
-                
-                if (ii > 0){
-                    size_t maxIdx = equidistantPoints.size() - 1;
-                    lengthAlongPath = lengthAlongPath + glm::distance(startVertex,equidistantPoints[maxIdx]);
-                }
-                
-                equidistantPoints.push_back(startVertex);
-
-				if (polyLineLabels.size() > i) {
-					equidistantPointsPathIDs.push_back(polyLineLabels[i]);
-				}
-				//                size_t idx = equidistantPoints.size()-1;
-//                cout << "vertex-x: "  << equidistantPoints[idx].x << " vertex-y: "  << equidistantPoints[idx].y << endl;
-                float pathLength;
-                
-                if(polylineVertices[ii] != polylineVertices[ii+1]){
-//                    pathLength = glm::distance(polylineVertices[ii], polylineVertices[ii+1]);
-                    int idx1 = currentPathVerticesIndices[ii];
-                    int idx2 = currentPathVerticesIndices[ii+1];
-                    float lengthAtIndex1 = polyline.getLengthAtIndex(idx1);
-                    float lengthAtIndex2 = polyline.getLengthAtIndex(idx2);
-                    pathLength = abs(lengthAtIndex2 - lengthAtIndex1);
-                }else{
-                    pathLength = polyline.getPerimeter();
-                }
-                
-                // Determine the number of points for this path segment
-                int numPointsForPath = std::round(pathLength / segmentLength);
-                
-                // Ensure points are distributed approximately equidistantly
-                lengthStep = pathLength / (numPointsForPath + 1); // add 1 cuz number of segments is numPointsForPath+1
-                
-                // now loop over the points between vertices
-                for (int j = 1; j <= numPointsForPath; j++) {
-                    lengthAlongPath = lengthAlongPath + lengthStep;
-                    glm::vec3 point = polyline.getPointAtLength(lengthAlongPath);
-                    equidistantPoints.push_back(point);
-					if (polyLineLabels.size() > i) {
-						equidistantPointsPathIDs.push_back(polyLineLabels[i]);
-					}
-					//                    idx = equidistantPoints.size()-1;
-//                    cout << " j " << j << " point-x: "  << equidistantPoints[idx].x << " point-y: "  << equidistantPoints[idx].y << endl;
-                }
-            }
-            
-            glm::vec3 endVertex = polylineVertices[polylineVertices.size() - 1];
-            equidistantPoints.push_back(endVertex);
-			if (polyLineLabels.size() > i) {
-				equidistantPointsPathIDs.push_back(polyLineLabels[i]);
-			}
-			//            size_t idx = equidistantPoints.size()-1;
-//            cout << "vertex-x: "  << equidistantPoints[idx].x << " vertex-y: "  << equidistantPoints[idx].y << endl;
-            size_t lastIdx = equidistantPoints.size()-1;
-            float distFirstToLast = glm::distance(equidistantPoints[lastIdx], equidistantPoints[0]);
-                        
+    return *parsed;
+}
+
+namespace {
+
+// Middle of the bounding box in x and y
+glm::vec3 boundsMidpoint(const std::vector<glm::vec3>& points) {
+    float minX = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest();
+    float minY = std::numeric_limits<float>::max();
+    float maxY = std::numeric_limits<float>::lowest();
+
+    for (const auto& point : points) {
+        if (point.x < minX) minX = point.x;
+        if (point.x > maxX) maxX = point.x;
+        if (point.y < minY) minY = point.y;
+        if (point.y > maxY) maxY = point.y;
+    }
+    return glm::vec3((minX + maxX) / 2.0f, (minY + maxY) / 2.0f, 0);
+}
+
+// One outline of the SVG with the arc length at each of its points, as ofPolyline::getLengthAtIndex has them:
+// lengths[i] is the length up to point i, and a closed outline has one more entry for the way back to point 0
+struct outlineLengths {
+    const ofPolyline* polyline = nullptr;
+    std::vector<float> lengths;
+    float perimeter = 0;
+
+    std::vector<glm::vec3> vertices;    // corners, plus the first one again if a closed outline ends elsewhere
+    std::vector<int> vertexIndices;     // point index of every corner
+    std::vector<glm::vec3> points;      // resampled, in the order generateEquidistantPoints emits them
+};
+
+void measureOutline(outlineLengths& outline) {
+    const auto& points = outline.polyline->getVertices();
+    size_t n = points.size();
+    bool closed = outline.polyline->isClosed();
+
+    outline.lengths.clear();
+    float length = 0;
+    for (size_t j = 0; j < n; ++j) {
+        outline.lengths.push_back(length);
+        size_t next = j + 1 < n ? j + 1 : (closed ? 0 : j);
+        length += glm::length(points[next] - points[j]);
+    }
+    if (closed && n > 0) outline.lengths.push_back(length);
+    outline.perimeter = n < 2 ? 0 : outline.lengths.back();
+
+    // First and last points are always vertices, in between the ones where the outline turns by more than 10 degrees
+    for (size_t j = 0; j < n; ++j) {
+        bool corner = j == 0 || j == n - 1;
+        if (!corner) {
+            glm::vec3 prev = points[j - 1] - points[j];
+            glm::vec3 next = points[j + 1] - points[j];
+            float angle = std::acos(glm::dot(glm::normalize(prev), glm::normalize(next)));
+            corner = angle < glm::radians(170.0f);
+        }
+        if (corner) {
+            outline.vertices.push_back(points[j]);
+            outline.vertexIndices.push_back(int(j));
         }
     }
-    
+    // a closed outline ends on its first vertex
+    if (closed && n > 0 && outline.vertices.back() != outline.vertices.front()) {
+        outline.vertices.push_back(outline.vertices.front());
+    }
+}
+
+// Point at a given arc length, like ofPolyline::getPointAtLength, for lengths that never decrease between calls:
+// the segment only moves forward, so walking a whole outline costs one pass over its points
+class lengthCursor {
+public:
+    explicit lengthCursor(const outlineLengths& outline) : points(outline.polyline->getVertices()), lengths(outline.lengths) {}
+
+    glm::vec3 pointAt(float length) {
+        if (points.size() < 2) return points.empty() ? glm::vec3() : points[0];
+        length = ofClamp(length, 0, lengths.back());
+        while (segment + 2 < lengths.size() && lengths[segment + 1] < length) segment++;
+
+        float segmentLength = lengths[segment + 1] - lengths[segment];
+        float t = segmentLength > FLT_EPSILON ? (length - lengths[segment]) / segmentLength : 0;
+        return glm::mix(points[segment], points[(segment + 1) % points.size()], t);
+    }
+
+private:
+    const std::vector<glm::vec3>& points;
+    const std::vector<float>& lengths;
+    size_t segment = 0;
+};
+
+// Points between the vertices of one outline, segmentLength apart as far as the vertices allow
+void resampleOutline(outlineLengths& outline, float segmentLength) {
+    const auto& vertices = outline.vertices;
+    if (vertices.empty()) return;
+
+    lengthCursor cursor(outline);
+    float lengthAlongPath = 0;
+    for (size_t ii = 0; ii + 1 < vertices.size(); ++ii) {
+        glm::vec3 startVertex = vertices[ii];
+        if (ii > 0) {
+            lengthAlongPath += glm::distance(startVertex, outline.points.back());
+        }
+        outline.points.push_back(startVertex);
+
+        float pathLength;
+        if (vertices[ii] != vertices[ii + 1]) {
+            // the repeated first vertex of a closed outline sits at the end of lengths, one perimeter along
+            size_t endIndex = ii + 1 < outline.vertexIndices.size() ? outline.vertexIndices[ii + 1] : outline.lengths.size() - 1;
+            pathLength = std::abs(outline.lengths[endIndex] - outline.lengths[outline.vertexIndices[ii]]);
+        } else {
+            pathLength = outline.perimeter;
+        }
+
+        int numPointsForPath = std::round(pathLength / segmentLength);
+        float lengthStep = pathLength / (numPointsForPath + 1); // numPointsForPath + 1 segments between the vertices
+        for (int j = 1; j <= numPointsForPath; j++) {
+            lengthAlongPath += lengthStep;
+            outline.points.push_back(cursor.pointAt(lengthAlongPath));
+        }
+    }
+    outline.points.push_back(vertices.back());
+}
+
+}
+
+void svgSkeleton::generateEquidistantPoints(int numDesiredPoints) {
+    traceRecorder::scope trace("generateEquidistantPoints");
+
+    if (openedFileName != fileName) {
+        openFile();     // restored from a snapshot
+    }
+    requestedPoints = numDesiredPoints;
+
+    bool precompiled = compiled && compiled->requestedPoints == numDesiredPoints;
+    if (precompiled) {
+        resampled = std::shared_ptr<const skeletonCache::resampledPoints>(compiled, &compiled->points);
+    }
+    else {
+        auto& cache = skeletonCache::shared();
+        uint64_t hash = svgHash();
+        resampled = hash != 0 ? cache.findPoints(hash, numDesiredPoints) : nullptr;
+        if (!resampled) {
+            auto points = std::make_shared<skeletonCache::resampledPoints>();
+            resample(numDesiredPoints, *points);
+            resampled = points;
+            if (hash != 0) cache.addPoints(hash, numDesiredPoints, resampled);
+        }
+    }
+    equidistantPoints = resampled->points;
+    equidistantPointsPathIDs = resampled->pathIDs;
+
     // Apply the stored translation and scale to the newly generated points
-    calculateSvgMidpoint();
+    if (precompiled) {
+        svgMidpoint.set(compiled->midpoint.x, compiled->midpoint.y);
+    } else {
+        calculateSvgMidpoint();
+    }
     glm::vec3 midpoint(svgMidpoint.x, svgMidpoint.y, svgMidpoint.z);
     
     // add the midpoint as the final element in equidistantPoints
@@ -204,14 +235,85 @@ void svgSkeleton::generateEquidistantPoints(int numDesiredPoints) {
     for (auto& point : equidistantPoints) {
         point = svgMidpoint + (point - svgMidpoint) * cumulativeScale + translation;
     }
+}
+
+// The untransformed points, without the midpoint
+void svgSkeleton::resample(int numDesiredPoints, skeletonCache::resampledPoints& resampled) {
+    const auto& file = parsedFile();
+    const auto& polyLineLabels = file.pathLabels;
+    auto& equidistantPoints = resampled.points;
+    auto& equidistantPointsPathIDs = resampled.pathIDs;
+
+    // Step 1: the outlines as svgLoader read them, by reference
+    std::vector<outlineLengths> outlines(file.outlines.size());
+    for (size_t i = 0; i < outlines.size(); i++) {
+        outlines[i].polyline = &file.outlines[i];
+    }
+
+    // Step 2: arc lengths and vertices of each outline
+    workerPool::parallelFor(pool, outlines.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) measureOutline(outlines[i]);
+    });
+
+    float totalPathLength = 0;
+    int numVertices = 0;
+    for (const auto& outline : outlines) {
+        totalPathLength += outline.perimeter;
+        numVertices += int(outline.vertexIndices.size());
+    }
+
+    // Calculate the remaining points needed after vertices are accounted for
+    int remainingPoints = numDesiredPoints - numVertices - 1; // -1 to avoid counting centroid
+    if (remainingPoints <= 0) {
+        // If remaining points are zero or less, just return the vertices
+        for (const auto& outline : outlines) {
+            equidistantPoints.insert(equidistantPoints.end(), outline.vertices.begin(), outline.vertices.begin() + outline.vertexIndices.size());
+        }
+        if (!polyLineLabels.empty()) {
+            equidistantPointsPathIDs.assign(equidistantPoints.size(), polyLineLabels[0]);  // Assuming all vertices belong to the first path, adjust as needed
+        }
+    }
+    else {
+        // Step 3: each outline resampled on its own, then joined in path order
+        float segmentLength = totalPathLength / remainingPoints;
+        workerPool::parallelFor(pool, outlines.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) resampleOutline(outlines[i], segmentLength);
+        });
+
+        size_t numPoints = 0;
+        for (const auto& outline : outlines) numPoints += outline.points.size();
+        equidistantPoints.reserve(numPoints + 1);
+        equidistantPointsPathIDs.reserve(numPoints + 1);
+        for (size_t i = 0; i < outlines.size(); ++i) {
+            const auto& points = outlines[i].points;
+            equidistantPoints.insert(equidistantPoints.end(), points.begin(), points.end());
+            if (polyLineLabels.size() > i) {
+                equidistantPointsPathIDs.insert(equidistantPointsPathIDs.end(), points.size(), polyLineLabels[i]);
+            }
+        }
+    }
 
-	vboRenderer.load();
-	vboRenderer.update(equidistantPoints);
+    for (auto& outline : outlines) {
+        resampled.pathVertices.push_back(std::move(outline.vertices));
+        resampled.pathVerticesIndices.push_back(std::move(outline.vertexIndices));
+    }
+}
+
+bool svgSkeleton::saveCompiled(const std::string& filename) {
+    if (!resampled) return false;
+    compiledSkeleton skeleton;
+    skeleton.svgFile = svgFile;
+    skeleton.requestedPoints = requestedPoints;
+    skeleton.width = compiled ? compiled->width : parsedFile().width;
+    skeleton.height = compiled ? compiled->height : parsedFile().height;
+    skeleton.midpoint = boundsMidpoint(resampled->points);
+    skeleton.points = *resampled;
+    return skeleton.save(ofToDataPath(filename));
 }
 
 void svgSkeleton::autoFitToWindow(int windowWidth, int windowHeight) {
-    float svgWidth = svg.getWidth();
-    float svgHeight = svg.getHeight();
+    float svgWidth = compiled ? compiled->width : parsedFile().width;
+    float svgHeight = compiled ? compiled->height : parsedFile().height;
     float scaleX = static_cast<float>(windowWidth) / svgWidth;
     float scaleY = static_cast<float>(windowHeight) / svgHeight;
     float scale = std::min(scaleX, scaleY) * 0.9f; // Scale down slightly to fit within window
@@ -229,20 +331,10 @@ void svgSkeleton::calculateSvgMidpoint() {
     
     if (equidistantPoints.empty()) return;
 
-    float minX = std::numeric_limits<float>::max();
-    float maxX = std::numeric_limits<float>::lowest();
-    float minY = std::numeric_limits<float>::max();
-    float maxY = std::numeric_limits<float>::lowest();
-
-    for (const auto& point : equidistantPoints) {
-        if (point.x < minX) minX = point.x;
-        if (point.x > maxX) maxX = point.x;
-        if (point.y < minY) minY = point.y;
-        if (point.y > maxY) maxY = point.y;
-    }
     // Calculate the midpoint
-    svgMidpoint.x = (minX + maxX) / 2.0f;
-    svgMidpoint.y = (minY + maxY) / 2.0f;
+    glm::vec3 midpoint = boundsMidpoint(equidistantPoints);
+    svgMidpoint.x = midpoint.x;
+    svgMidpoint.y = midpoint.y;
 }
 
 void svgSkeleton::translateSvg(const ofPoint& offset) {
@@ -444,13 +536,17 @@ void svgSkeleton::calculateAdjustedCrossSize() {
     crossSizeY = maxDistance * crossSizeScaleFactor;
 }
 
-void svgSkeleton::writeSvg(const std::vector<glm::vec3>& particlePositions) {
+void svgSkeleton::writeSvg(const particleStreams& particlePositions, const std::string& outputFilename) {
+    traceRecorder::scope trace("writeSvg");
     // Ensure the vectors are valid and particlePositions has one less element than equidistantPoints
     if (particlePositions.empty() || equidistantPoints.size() <= 1 || equidistantPointsPathIDs.size() <= 1) return;
 
-    // Get the current timestamp for the filename
-    std::string timestamp = ofGetTimestampString("%Y-%m-%d_%H-%M-%S");
-    std::string filename = "output_" + timestamp + ".svg";
+    // Without a name, use the current timestamp for the filename
+    std::string filename = outputFilename;
+    if (filename.empty()) {
+        std::string timestamp = ofGetTimestampString("%Y-%m-%d_%H-%M-%S");
+        filename = "output_" + timestamp + ".svg";
+    }
 
     std::ofstream svgFile;
     svgFile.open(ofToDataPath(filename));
@@ -461,26 +557,26 @@ void svgSkeleton::writeSvg(const std::vector<glm::vec3>& particlePositions) {
         svgFile << "<!-- Created with custom OpenFrameworks app -->\n";
         svgFile << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n";
 
-        // Map to store path points by path ID
-        std::map<std::string, std::vector<glm::vec3>> pointsByPath;
+        // Map to store the particle indices belonging to each path ID
+        std::map<std::string, std::vector<size_t>> pointsByPath;
 
         // Group the particle positions by their path ID, starting from index 1
         for (size_t i = 0; i < particlePositions.size(); ++i) {
             const std::string& pathID = equidistantPointsPathIDs[i + 1];  // Skip the midpoint (index 0)
-            pointsByPath[pathID].push_back(particlePositions[i]);
+            pointsByPath[pathID].push_back(i);
         }
 
         // Write each path's points
         for (const auto& pathPair : pointsByPath) {
             const std::string& pathId = pathPair.first;
-            const std::vector<glm::vec3>& pathPoints = pathPair.second;
+            const std::vector<size_t>& pathPoints = pathPair.second;
 
             svgFile << "<path id=\"" << pathId << "\" style=\"fill:none;stroke:#030303;stroke-width:0.3\" d=\"";
             svgFile << "M ";
 
             for (size_t i = 0; i < pathPoints.size(); ++i) {
-                const glm::vec3& point = pathPoints[i];
-                svgFile << point.x << " " << point.y;
+                size_t idx = pathPoints[i];
+                svgFile << particlePositions.x[idx] << " " << particlePositions.y[idx];
                 if (i != pathPoints.size() - 1) {
                     svgFile << " L ";
                 }
@@ -497,3 +593,27 @@ void svgSkeleton::writeSvg(const std::vector<glm::vec3>& particlePositions) {
         ofLogError() << "Unable to open file for writing: " << filename;
     }
 }
+
+void svgSkeleton::saveState(skeletonState& state) const {
+    state.fileName = fileName;
+    state.requestedPoints = requestedPoints;
+    state.points = equidistantPoints;
+    state.pathIDs = equidistantPointsPathIDs;
+    state.midpoint = svgMidpoint;
+    state.translation = translation;
+    state.scale = cumulativeScale;
+    state.rotation = currentRotationAngle;
+}
+
+void svgSkeleton::restoreState(const skeletonState& state) {
+    fileName = state.fileName;
+    requestedPoints = state.requestedPoints;
+    equidistantPoints = state.points;
+    equidistantPointsPathIDs = state.pathIDs;
+    svgMidpoint = state.midpoint;
+    translation = state.translation;
+    cumulativeScale = state.scale;
+    currentRotationAngle = state.rotation;
+    crossSizeScaleFactor = 1.05f;
+    calculateAdjustedCrossSize();
+}
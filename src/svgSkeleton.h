@@ -1,13 +1,28 @@
 #pragma once
 
 #include "ofMain.h"
-#include "ofxSVG.h"
 #include "particleRenderer.h"
+#include "compiledSkeleton.h"
+#include "skeletonCache.h"
+#include "workerPool.h"
+
+// The resampled skeleton and its transform, without the SVG it came from (see simulationSnapshot.h)
+struct skeletonState {
+    std::string fileName;
+    int requestedPoints = 0;            // numDesiredPoints of the last generateEquidistantPoints
+    std::vector<glm::vec3> points;      // equidistantPoints, midpoint first
+    std::vector<std::string> pathIDs;   // path ID of every point
+    ofPoint midpoint;
+    ofPoint translation;
+    float scale = 1.0f;
+    float rotation = 0.0f;
+};
 
 class svgSkeleton {
 public:
     void loadSvg(const std::string& filename);
     void generateEquidistantPoints(int numDesiredPoints);
+    void setWorkerPool(workerPool* pool) { this->pool = pool; }    // e.g. particleEnsemble::getWorkerPool(); none = serial
     void calculateSvgMidpoint();       
     void translateSvg(const ofPoint& offset);
     void resizeSvg(float scale, bool loadingSvg);
@@ -47,10 +62,32 @@ public:
     
     void calculateAdjustedCrossSize();
     
-    void writeSvg(const std::vector<glm::vec3>& particlePositions);
+    void writeSvg(const particleStreams& particlePositions, const std::string& outputFilename = ""); // empty name: output_<timestamp>.svg
+
+    // The points of the last generateEquidistantPoints as a .dyskel (see compiledSkeleton.h), name relative to bin/data
+    bool saveCompiled(const std::string& filename);
+
+    // Snapshots. restoreState does not read the SVG; that waits until the points are generated again.
+    void saveState(skeletonState& state) const;
+    void restoreState(const skeletonState& state);
     
 private:
-    ofxSVG svg;
+    // fileName is an SVG or a .dyskel. The points come from the .dyskel for the point count it was compiled for,
+    // otherwise from skeletonCache::shared() when they are there, otherwise from resampling the SVG.
+    void openFile();
+    uint64_t svgHash();
+    const svgDocument& parsedFile();                // outlines and path IDs of svgFile, from the cache or read now
+    void resample(int numDesiredPoints, skeletonCache::resampledPoints& resampled);
+    std::string openedFileName;                     // fileName that svgFile and compiled belong to
+    std::string svgFile;                            // fileName, or the SVG the .dyskel was compiled from
+    std::shared_ptr<const compiledSkeleton> compiled;   // when fileName is a .dyskel
+    std::shared_ptr<const svgDocument> parsed;
+    uint64_t parsedHash = 0;                        // file parsed holds
+    uint64_t fileHash = 0;                          // contents of svgFile, 0 if it could not be read
+    std::string hashedFileName;                     // file fileHash belongs to
+    std::shared_ptr<const skeletonCache::resampledPoints> resampled;    // equidistantPoints before the transform
+    int requestedPoints = 0;
+
     std::vector<glm::vec3> equidistantPoints;
     ofPoint svgMidpoint;   // currently holding svgMidpoint information
     std::string fileName; // Add this member to store the file name
@@ -65,12 +102,10 @@ private:
 
 	particleRenderer vboRenderer;
 
-    std::vector<std::string> polyLineLabels;  // Labels (IDs) for each path
     std::vector<std::string> pathIDMembership;
     std::vector<std::string> equidistantPointsPathIDs;  // path IDs for equidistantPoints entries
-    
-    std::vector<std::vector<glm::vec3>> pathVertices;  // Stores the xyz coordinates of each polyline'x vertices
-    std::vector<std::vector<int>>pathVerticesIndices;  // Stores the indices of each polyline's vertices
+
+    workerPool* pool = nullptr;     // generateEquidistantPoints resamples the outlines on it when set
     
     void calculateMaxDistances(float& maxDistanceX, float& maxDistanceY) const;
     
@@ -0,0 +1,69 @@
+#include "timeReversalSchedule.h"
+#include "ofMain.h"
+
+float timeReversalSchedule::nextTimestep() {
+    if (timeReversalInProgress) {
+        return gentlyReverseTimeWithCos();
+    }
+
+    // Check if time reversal should start
+    if (reversalActive && elapsedTimesteps == reversalTimestep) {
+        reversalTimestep = -reversalTimestep;
+        startReversal();
+    }
+    return timeForward ? timestep : -timestep;  // Continue with normal time progression
+}
+
+void timeReversalSchedule::stepTaken() {
+    if (timeForward) {
+        elapsedTimesteps++;
+    }
+    else {
+        elapsedTimesteps--;
+    }
+}
+
+void timeReversalSchedule::startReversal() {
+    if (timeReversalInProgress) return;
+    timeReversalInProgress = true;
+    nTimeReversalCalls = 0;
+    timeReversalStepCounter = nTimeReversalSteps;
+    if (timeForward){originalTimeStep = timestep;}
+    else{originalTimeStep = -1.0*timestep;}
+}
+
+void timeReversalSchedule::reset() {
+    elapsedTimesteps = 0;
+    timeForward = true;
+    timeReversalInProgress = false;
+}
+
+float timeReversalSchedule::gentlyReverseTimeWithCos() {
+    float new_timeStep, stepSize;
+    
+    ++nTimeReversalCalls;
+    
+    stepSize = 2 * PI / (2 * nTimeReversalSteps + 1);
+    
+    if (timeReversalStepCounter > 0) {       // slowly reduce the size of the timestep
+        new_timeStep = originalTimeStep * 0.5 * (cos(nTimeReversalCalls * stepSize) + 1);
+    } else if (timeReversalStepCounter == 0) {   // flip the sign
+        new_timeStep = -1.0 * last_timeStep;
+        originalTimeStep *= -1;
+        timeForward = !timeForward;
+    } else {   // slowly increase the size of the timestep
+        // cos((2n + 1 - k) * stepSize) == cos(k * stepSize), but evaluated at the mirrored k it is the same bits as on
+        // the way down, so each step of the ramp up undoes one of the ramp down exactly (see fixedPointVerlet)
+        int mirroredCall = 2 * nTimeReversalSteps + 1 - nTimeReversalCalls;
+        new_timeStep = originalTimeStep * 0.5 * (cos(mirroredCall * stepSize) + 1);
+    }
+    
+    timeReversalStepCounter -= 1;
+
+    if (timeReversalStepCounter < (-1 * nTimeReversalSteps)) {
+        timeReversalInProgress = false;
+    }
+    
+    last_timeStep = new_timeStep;
+    return new_timeStep;
+}
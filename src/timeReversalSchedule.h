@@ -0,0 +1,35 @@
+#pragma once
+
+// Timestep schedule of the simulation: a constant dt, and around a time reversal a cosine ramp down to zero,
+// a sign flip and a ramp back up (gentlyReverseTimeWithCos), so the particles retrace their trajectory.
+// Plain state, so it can be stepped from the simulation thread and copied into checkpoints.
+class timeReversalSchedule {
+public:
+    float nextTimestep();   // dt for the coming step; starts a reversal when elapsedTimesteps reaches reversalTimestep
+    void stepTaken();       // counts the step just taken in the current direction
+    void startReversal();   // reverses now, unless a reversal is already running
+    void reset();           // back to step 0, going forward
+
+    // Steps from step 0 through the reversal at reversalStep back to step 0: the step that starts the reversal, both
+    // ramps, the flip and the way back
+    int sequenceLength(int reversalStep) const { return 2 * (reversalStep + nTimeReversalSteps + 1); }
+
+    float timestep = 0.003;
+    bool reversalActive = false;    // reverse automatically at reversalTimestep
+    int reversalTimestep = 2000;    // negated when the reversal starts, so the way back reverses again at -reversalTimestep
+    int nTimeReversalSteps = 120;   // length of each ramp
+
+    long long elapsedTimesteps = 0;
+    bool timeForward = true;
+    bool timeReversalInProgress = false;
+
+private:
+    friend struct simulationSnapshot;   // writes the ramp state below
+
+    float gentlyReverseTimeWithCos();
+
+    int timeReversalStepCounter = 120;
+    int nTimeReversalCalls = 0;
+    float last_timeStep = 0.003;
+    float originalTimeStep = 0.003;
+};
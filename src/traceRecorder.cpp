@@ -0,0 +1,150 @@
+#include "traceRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> traceRecorder::recording{false};
+
+namespace {
+    struct traceEvent {
+        std::string name;
+        double timestamp;   // microseconds since the capture started
+        char phase;         // 'B', 'E' or 'i'
+    };
+
+    struct threadBuffer {
+        std::mutex mutex;   // only contended while the file is written
+        std::vector<traceEvent> events;
+        std::string threadName;
+        int tid = 0;
+    };
+
+    const size_t maxEventsPerThread = 4 << 20;  // ~200 MB of events, a runaway capture stops growing there
+
+    std::mutex registryMutex;
+    std::vector<std::shared_ptr<threadBuffer>> buffers;   // kept after a thread exits so its events still get written
+    int nextTid = 1;
+
+    // steady_clock ticks at the start of the capture; atomic because a worker still finishing an event of the last
+    // capture may read it while startCapture sets the next one
+    std::atomic<std::chrono::steady_clock::rep> originTicks{std::chrono::steady_clock::now().time_since_epoch().count()};
+
+    // capture state, main thread only
+    int framesLeft = 0;
+    bool frameOpen = false;
+
+    threadBuffer& localBuffer() {
+        thread_local std::shared_ptr<threadBuffer> buffer;
+        if (!buffer) {
+            buffer = std::make_shared<threadBuffer>();
+            std::lock_guard<std::mutex> lock(registryMutex);
+            buffer->tid = nextTid++;
+            buffers.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    void writeEscaped(std::ofstream& file, const std::string& text) {
+        for (char c : text) {
+            if (c == '"' || c == '\\') file << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20) file << ' ';
+            else file << c;
+        }
+    }
+}
+
+void traceRecorder::record(const std::string& name, char phase) {
+    std::chrono::steady_clock::duration sinceOrigin = std::chrono::steady_clock::now().time_since_epoch()
+        - std::chrono::steady_clock::duration(originTicks.load(std::memory_order_relaxed));
+    double timestamp = std::chrono::duration<double, std::micro>(sinceOrigin).count();
+    threadBuffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.events.size() < maxEventsPerThread) {
+        buffer.events.push_back({name, timestamp, phase});
+    }
+}
+
+void traceRecorder::begin(const std::string& name) {
+    if (isRecording()) record(name, 'B');
+}
+
+void traceRecorder::end(const std::string& name) {
+    if (isRecording()) record(name, 'E');
+}
+
+void traceRecorder::instant(const std::string& name) {
+    if (isRecording()) record(name, 'i');
+}
+
+void traceRecorder::setThreadName(const std::string& name) {
+    threadBuffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.threadName = name;
+}
+
+void traceRecorder::startCapture(int nFrames) {
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& buffer : buffers) {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            buffer->events.clear();
+        }
+    }
+    originTicks.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    framesLeft = std::max(nFrames, 1);
+    frameOpen = false;
+    recording.store(true, std::memory_order_release);   // pairs with isRecording: a thread that sees it sees the origin
+}
+
+bool traceRecorder::frameBoundary() {
+    if (!isRecording()) return false;
+    if (frameOpen) {
+        end("frame");
+        --framesLeft;
+    }
+    if (framesLeft <= 0) {
+        recording = false;
+        frameOpen = false;
+        return true;
+    }
+    begin("frame");
+    frameOpen = true;
+    return false;
+}
+
+bool traceRecorder::write(const std::string& path) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& buffer : buffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        if (!buffer->threadName.empty()) {
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+                 << ",\"args\":{\"name\":\"";
+            writeEscaped(file, buffer->threadName);
+            file << "\"}}";
+            first = false;
+        }
+        for (const auto& event : buffer->events) {
+            file << (first ? "" : ",\n") << "{\"name\":\"";
+            writeEscaped(file, event.name);
+            file << "\",\"cat\":\"dyantra\",\"ph\":\"" << event.phase << "\",\"ts\":" << event.timestamp
+                 << ",\"pid\":1,\"tid\":" << buffer->tid;
+            if (event.phase == 'i') file << ",\"s\":\"t\"";
+            file << "}";
+            first = false;
+        }
+        buffer->events.clear();
+    }
+    file << "\n]}\n";
+    return file.good();
+}
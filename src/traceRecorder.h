@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+// Begin/end events with thread ids, written as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+// Nothing is recorded outside a capture, and a scope then costs one acquire load of the recording flag.
+// Each thread appends to its own buffer, so workers do not contend while a capture runs.
+class traceRecorder {
+public:
+    // Begin event now, end event when it goes out of scope
+    class scope {
+    public:
+        explicit scope(const char* name) : name(name), active(isRecording()) {
+            if (active) begin(name);
+        }
+        ~scope() {
+            if (active) end(name);
+        }
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+    private:
+        const char* name;
+        bool active;
+    };
+
+    static bool isRecording() { return recording.load(std::memory_order_acquire); }
+
+    static void begin(const std::string& name);
+    static void end(const std::string& name);
+    static void instant(const std::string& name);   // a marker, e.g. a sequence transition
+
+    static void setThreadName(const std::string& name);  // shown as the track name in the viewer
+
+    // Records the next nFrames frames
+    static void startCapture(int nFrames);
+    // Call once per frame on the main thread; wraps each frame in a "frame" event.
+    // Returns true on the frame the capture ends, the events are then ready for write().
+    static bool frameBoundary();
+    // Writes the captured events as JSON to path (a full path, see ofToDataPath) and drops them
+    static bool write(const std::string& path);
+
+private:
+    static void record(const std::string& name, char phase);
+
+    static std::atomic<bool> recording;
+};
@@ -0,0 +1,274 @@
+#include "trajectoryFile.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // LZMA-style binary range coder with 11-bit adaptive probabilities
+    const int probabilityBits = 11;
+    const uint16_t probabilityHalf = 1 << (probabilityBits - 1);
+    const int adaptShift = 5;
+    const uint32_t topValue = 1u << 24;
+
+    class rangeEncoder {
+    public:
+        explicit rangeEncoder(std::vector<uint8_t>& out) : out(out) {}
+
+        void encodeBit(uint16_t& probability, int bit) {
+            uint32_t bound = (range >> probabilityBits) * probability;
+            if (bit == 0) {
+                range = bound;
+                probability += ((1 << probabilityBits) - probability) >> adaptShift;
+            } else {
+                low += bound;
+                range -= bound;
+                probability -= probability >> adaptShift;
+            }
+            normalize();
+        }
+
+        void encodeDirect(uint32_t value, int nBits) {
+            for (int i = nBits - 1; i >= 0; --i) {
+                range >>= 1;
+                if ((value >> i) & 1) low += range;
+                normalize();
+            }
+        }
+
+        void flush() {
+            for (int i = 0; i < 5; ++i) shiftLow();
+        }
+
+    private:
+        void normalize() {
+            while (range < topValue) {
+                range <<= 8;
+                shiftLow();
+            }
+        }
+
+        void shiftLow() {
+            if (uint32_t(low) < 0xff000000u || (low >> 32) != 0) {
+                uint8_t carry = uint8_t(low >> 32);
+                uint8_t pending = cache;
+                do {
+                    out.push_back(uint8_t(pending + carry));
+                    pending = 0xff;
+                } while (--cacheSize != 0);
+                cache = uint8_t(low >> 24);
+            }
+            ++cacheSize;
+            low = (low & 0x00ffffffu) << 8;
+        }
+
+        std::vector<uint8_t>& out;
+        uint64_t low = 0;
+        uint32_t range = 0xffffffffu;
+        uint8_t cache = 0;
+        uint64_t cacheSize = 1;
+    };
+
+    class rangeDecoder {
+    public:
+        rangeDecoder(const uint8_t* data, size_t bytes) : data(data), end(data + bytes) {
+            for (int i = 0; i < 5; ++i) code = (code << 8) | nextByte();
+        }
+
+        int decodeBit(uint16_t& probability) {
+            uint32_t bound = (range >> probabilityBits) * probability;
+            int bit;
+            if (code < bound) {
+                range = bound;
+                probability += ((1 << probabilityBits) - probability) >> adaptShift;
+                bit = 0;
+            } else {
+                code -= bound;
+                range -= bound;
+                probability -= probability >> adaptShift;
+                bit = 1;
+            }
+            normalize();
+            return bit;
+        }
+
+        uint32_t decodeDirect(int nBits) {
+            uint32_t value = 0;
+            for (int i = 0; i < nBits; ++i) {
+                range >>= 1;
+                uint32_t bit = code >= range ? 1 : 0;
+                if (bit) code -= range;
+                value = (value << 1) | bit;
+                normalize();
+            }
+            return value;
+        }
+
+        bool overran() const { return overrun; }
+
+    private:
+        uint8_t nextByte() {
+            if (data < end) return *data++;
+            overrun = true;
+            return 0;
+        }
+
+        void normalize() {
+            while (range < topValue) {
+                range <<= 8;
+                code = (code << 8) | nextByte();
+            }
+        }
+
+        const uint8_t* data;
+        const uint8_t* end;
+        uint32_t code = 0;
+        uint32_t range = 0xffffffffu;
+        bool overrun = false;
+    };
+
+    // Prediction residuals, zigzagged to unsigned, as a bit length (0..32) and the bits below the leading one. The
+    // bit length is coded with a 6-level bit tree in the context of the previous particle's bit length, the first
+    // bit below the leading one adaptively, the rest directly.
+    const int nLengthContexts = 17;
+
+    struct residualModel {
+        uint16_t length[nLengthContexts][64];
+        uint16_t firstBit[33];
+        int previousLength = 0;
+
+        residualModel() {
+            std::fill(&length[0][0], &length[0][0] + nLengthContexts * 64, probabilityHalf);
+            std::fill(firstBit, firstBit + 33, probabilityHalf);
+        }
+    };
+
+    uint32_t zigzag(int64_t value) {
+        return uint32_t(value < 0 ? ((-value) << 1) - 1 : value << 1);
+    }
+
+    int64_t unzigzag(uint32_t value) {
+        return (value & 1) ? -(int64_t(value) + 1) / 2 : int64_t(value) / 2;
+    }
+
+    int bitLength(uint32_t value) {
+        int n = 0;
+        while (value) {
+            ++n;
+            value >>= 1;
+        }
+        return n;
+    }
+
+    void encodeResidual(rangeEncoder& coder, residualModel& model, int64_t residual) {
+        uint32_t value = zigzag(residual);
+        int n = bitLength(value);
+        uint16_t* tree = model.length[std::min(model.previousLength, nLengthContexts - 1)];
+        for (int level = 5, node = 1; level >= 0; --level) {
+            int bit = (n >> level) & 1;
+            coder.encodeBit(tree[node], bit);
+            node = (node << 1) | bit;
+        }
+        if (n >= 2) {
+            coder.encodeBit(model.firstBit[n], (value >> (n - 2)) & 1);
+            coder.encodeDirect(value, n - 2);
+        }
+        model.previousLength = n;
+    }
+
+    int64_t decodeResidual(rangeDecoder& coder, residualModel& model) {
+        uint16_t* tree = model.length[std::min(model.previousLength, nLengthContexts - 1)];
+        int node = 1;
+        for (int level = 5; level >= 0; --level) {
+            node = (node << 1) | coder.decodeBit(tree[node]);
+        }
+        int n = std::min(node - 64, 32);
+        uint32_t value = n > 0 ? 1 : 0;
+        if (n >= 2) {
+            value = (value << 1) | coder.decodeBit(model.firstBit[n]);
+            value = (value << (n - 2)) | coder.decodeDirect(n - 2);
+        }
+        model.previousLength = n;
+        return unzigzag(value);
+    }
+
+    // Clamped to +-2^28 steps, so no residual needs more than 32 bits after the zigzag
+    int32_t quantize(float value, float scale) {
+        float q = std::round(value * scale);
+        const float limit = float(1 << 28);
+        return int32_t(std::max(-limit, std::min(q, limit)));
+    }
+
+    // What the coordinate of particle i is predicted to be
+    int64_t predict(int framesSinceKeyframe, const std::vector<int32_t>& current, const std::vector<int32_t>& previous,
+                    const std::vector<int32_t>& beforePrevious, size_t i) {
+        if (framesSinceKeyframe == 0) return i > 0 ? current[i - 1] : 0;
+        if (framesSinceKeyframe == 1) return previous[i];
+        return 2 * int64_t(previous[i]) - beforePrevious[i];
+    }
+}
+
+namespace trajectoryFile {
+
+void encoder::reset(size_t particles, float precision) {
+    nParticles = particles;
+    scale = 1.0f / precision;
+    framesSinceKeyframe = 0;
+    for (int axis = 0; axis < 2; ++axis) {
+        previous[axis].assign(nParticles, 0);
+        beforePrevious[axis].assign(nParticles, 0);
+    }
+}
+
+void encoder::encode(const float* x, const float* y, bool keyframe, std::vector<uint8_t>& out) {
+    if (keyframe) framesSinceKeyframe = 0;
+    rangeEncoder coder(out);
+    const float* coordinates[2] = {x, y};
+    for (int axis = 0; axis < 2; ++axis) {
+        residualModel model;
+        std::vector<int32_t>& current = beforePrevious[axis];    // the oldest frame is overwritten by the new one
+        for (size_t i = 0; i < nParticles; ++i) {
+            int64_t prediction = predict(framesSinceKeyframe, current, previous[axis], beforePrevious[axis], i);
+            int32_t value = quantize(coordinates[axis][i], scale);
+            current[i] = value;     // after the prediction read beforePrevious[i]
+            encodeResidual(coder, model, int64_t(value) - prediction);
+        }
+        std::swap(previous[axis], beforePrevious[axis]);
+    }
+    coder.flush();
+    ++framesSinceKeyframe;
+}
+
+void decoder::reset(size_t particles, float framePrecision) {
+    nParticles = particles;
+    precision = framePrecision;
+    framesSinceKeyframe = 0;
+    for (int axis = 0; axis < 2; ++axis) {
+        previous[axis].assign(nParticles, 0);
+        beforePrevious[axis].assign(nParticles, 0);
+    }
+}
+
+bool decoder::decode(const uint8_t* data, size_t bytes, bool keyframe, float* x, float* y) {
+    if (keyframe) framesSinceKeyframe = 0;
+    else if (framesSinceKeyframe == 0) return false;    // no keyframe to build on
+    rangeDecoder coder(data, bytes);
+    float* coordinates[2] = {x, y};
+    for (int axis = 0; axis < 2; ++axis) {
+        residualModel model;
+        std::vector<int32_t>& current = beforePrevious[axis];
+        for (size_t i = 0; i < nParticles; ++i) {
+            int64_t prediction = predict(framesSinceKeyframe, current, previous[axis], beforePrevious[axis], i);
+            int32_t value = int32_t(prediction + decodeResidual(coder, model));
+            current[i] = value;
+            coordinates[axis][i] = value * precision;
+        }
+        std::swap(previous[axis], beforePrevious[axis]);
+    }
+    if (coder.overran()) {
+        framesSinceKeyframe = 0;
+        return false;
+    }
+    ++framesSinceKeyframe;
+    return true;
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Recorded particle trajectories (.dytraj), written by trajectoryRecorder and played back by trajectoryPlayer.
+//
+//     fileHeader
+//     frame*          frameHeader + compressed positions
+//     index           indexHeader + one keyframeEntry per keyframe
+//     fileFooter      where the index starts
+//
+// Positions (x and y; the trajectories are planar) are quantized to multiples of 'precision' pixels. Each
+// coordinate is predicted and only the difference is stored: in a keyframe from the previous particle, in the
+// frame after from the same particle a frame earlier, after that by extrapolating its last two frames. The
+// differences go through an adaptive binary range coder (the one LZMA uses), which spends a few bits on the small
+// ones smooth motion leaves. A frame can be decoded once the frames since the last keyframe are, so seeking starts
+// at a keyframe. A file whose recording was cut short has no index; its frames can still be found by walking the
+// frame headers.
+namespace trajectoryFile {
+    static const char magic[8] = {'D', 'Y', 'T', 'R', 'A', 'J', 0, 0};
+    static const char footerMagic[8] = {'D', 'Y', 'T', 'R', 'I', 'D', 'X', 0};
+    static const uint32_t version = 1;
+    static const uint32_t byteOrderMark = 0x01020304;
+    static const uint32_t frameMarker = 0x4d415246;    // "FRAM"
+    static const uint32_t indexMarker = 0x58444e49;    // "INDX"
+
+    struct fileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t nParticles;
+        float precision;            // pixels per quantization step
+        uint32_t keyframeInterval;  // frames
+        uint32_t stepInterval;      // simulation steps per frame
+        uint32_t reserved;
+    };
+
+    struct frameHeader {
+        uint32_t marker;
+        uint32_t bytes;     // compressed positions that follow
+        int64_t step;       // simulation step of the frame (timeReversalSchedule::elapsedTimesteps)
+        uint32_t keyframe;
+        uint32_t reserved;
+    };
+
+    struct indexHeader {
+        uint32_t marker;
+        uint32_t reserved;
+        uint64_t nFrames;
+        uint64_t nKeyframes;
+    };
+
+    struct keyframeEntry {
+        uint64_t frame;
+        uint64_t offset;    // of its frameHeader, from the start of the file
+    };
+
+    struct fileFooter {
+        uint64_t indexOffset;
+        char magic[8];
+    };
+
+    // Quantizes, predicts and compresses frames. Frames have to be encoded in order; keyframes start afresh.
+    class encoder {
+    public:
+        void reset(size_t nParticles, float precision);
+        void encode(const float* x, const float* y, bool keyframe, std::vector<uint8_t>& out);
+
+    private:
+        size_t nParticles = 0;
+        float scale = 1.0f;
+        int framesSinceKeyframe = 0;
+        std::vector<int32_t> previous[2];       // quantized x and y of the last frame
+        std::vector<int32_t> beforePrevious[2];
+    };
+
+    // The reverse of encoder: frames decode in the order they were encoded, starting from a keyframe.
+    class decoder {
+    public:
+        void reset(size_t nParticles, float precision);
+        bool decode(const uint8_t* data, size_t bytes, bool keyframe, float* x, float* y);  // false if the frame is damaged
+        bool canDecodeDelta() const { return framesSinceKeyframe > 0; }  // a keyframe came first
+
+    private:
+        size_t nParticles = 0;
+        float precision = 1.0f;
+        int framesSinceKeyframe = 0;
+        std::vector<int32_t> previous[2];
+        std::vector<int32_t> beforePrevious[2];
+    };
+}
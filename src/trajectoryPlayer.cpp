@@ -0,0 +1,263 @@
+#include "trajectoryPlayer.h"
+#include "traceRecorder.h"
+#include "ofMain.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+bool trajectoryPlayer::open(const std::string& path) {
+    close();
+    if (!file.open(path)) {
+        ofLogError("trajectoryPlayer") << "Unable to open " << path;
+        return false;
+    }
+    const unsigned char* data = file.getData();
+    size_t size = file.getSize();
+    trajectoryFile::fileHeader header;
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, trajectoryFile::magic, sizeof(header.magic)) != 0
+        || header.version != trajectoryFile::version || header.byteOrder != trajectoryFile::byteOrderMark
+        || header.nParticles == 0 || !(header.precision > 0)) {
+        ofLogError("trajectoryPlayer") << path << " is not a trajectory this version can read";
+        file.close();
+        return false;
+    }
+    nParticles = size_t(header.nParticles);
+    precision = header.precision;
+    stepInterval = int(header.stepInterval);
+
+    // Walk the frame headers: a hop per frame, and it also finds the frames of a recording that was cut short.
+    // The index at the end is only needed by readers that cannot afford the walk.
+    frameOffsets.clear();
+    keyframes.clear();
+    uint64_t offset = sizeof(header);
+    while (offset + sizeof(trajectoryFile::frameHeader) <= size) {
+        trajectoryFile::frameHeader frame;
+        std::memcpy(&frame, data + offset, sizeof(frame));
+        if (frame.marker != trajectoryFile::frameMarker || frame.bytes > size - offset - sizeof(frame)) break;
+        if (frame.keyframe) keyframes.push_back((long long)frameOffsets.size());
+        frameOffsets.push_back(offset);
+        offset += sizeof(frame) + frame.bytes;
+    }
+    if (keyframes.empty() || keyframes[0] != 0) {
+        ofLogError("trajectoryPlayer") << path << " has no frames to play";
+        file.close();
+        return false;
+    }
+    nFrames = (long long)frameOffsets.size();
+
+    playhead = 0;
+    fetchedFrame = -1;
+    groupStart = -1;
+    decoderFrame = -1;
+    decoder.reset(nParticles, precision);
+    stopping = false;
+    queued.clear();
+    nextFrame = 0;
+    direction = speed < 0 ? -1 : 1;
+    stride = 1;
+    playheadStep = 1;
+    worker = std::thread(&trajectoryPlayer::run, this);
+    return true;
+}
+
+void trajectoryPlayer::close() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+    queued.clear();
+    spare.clear();
+    groupFrames.clear();
+    file.close();
+    nFrames = 0;
+}
+
+long long trajectoryPlayer::getStep(long long frame) const {
+    if (frame < 0 || frame >= nFrames) return 0;
+    trajectoryFile::frameHeader header;
+    std::memcpy(&header, file.getData() + frameOffsets[size_t(frame)], sizeof(header));
+    return header.step;
+}
+
+void trajectoryPlayer::seek(long long frame) {
+    playhead = double(std::max(0LL, std::min(frame, nFrames - 1)));
+}
+
+void trajectoryPlayer::advance(float seconds) {
+    if (nFrames == 0) return;
+    playheadStep = std::abs(double(speed) * seconds);
+    playhead += double(speed) * seconds;
+    if (loop) {
+        playhead = std::fmod(playhead, double(nFrames));
+        if (playhead < 0) playhead += double(nFrames);
+    } else {
+        playhead = std::max(0.0, std::min(playhead, double(nFrames - 1)));
+    }
+}
+
+long long trajectoryPlayer::nextInDirection(long long frame, int towards, long long step) const {
+    long long next = frame + towards * step;
+    if (loop) return ((next % nFrames) + nFrames) % nFrames;
+    long long last = towards < 0 ? 0 : nFrames - 1;
+    if (frame != last && (next - last) * towards > 0) return last;     // the playhead stops there, so show it
+    return next;    // may leave [0, nFrames): the worker then waits
+}
+
+// Signed distance from target to frame in the playing direction: positive ahead of the playhead, negative behind
+long long trajectoryPlayer::offset(long long frame, long long target, int towards) const {
+    long long distance = (frame - target) * towards;
+    if (loop) {
+        distance %= nFrames;
+        if (distance > nFrames / 2) distance -= nFrames;
+        else if (distance <= -nFrames / 2) distance += nFrames;
+    }
+    return distance;
+}
+
+void trajectoryPlayer::restart(long long frame, int towards) {
+    for (auto& old : queued) {
+        spare.push_back(std::move(old.positions));
+    }
+    queued.clear();
+    nextFrame = frame;
+    direction = towards;
+    ++generation;
+}
+
+bool trajectoryPlayer::fetch(particleStreams& positions) {
+    if (!isOpen()) return false;
+    long long target = getFrame();
+    int towards = speed < 0 ? -1 : 1;
+    if (target == fetchedFrame) return false;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    stride = std::max(1LL, (long long)playheadStep);
+    // the latest queued frame the playhead is on or went past during the last advance
+    auto it = queued.end();
+    for (auto candidate = queued.begin(); candidate != queued.end(); ++candidate) {
+        long long behind = -offset(candidate->frame, target, towards);
+        if (behind >= 0 && behind < stride) it = candidate;
+    }
+    if (it == queued.end()) {
+        // frames further behind are never shown
+        while (!queued.empty() && offset(queued.front().frame, target, towards) <= -stride) {
+            spare.push_back(std::move(queued.front().positions));
+            queued.pop_front();
+        }
+        // not decoded yet: wait while the worker is on its way there or the queue lies just ahead, else send it there
+        long long next = offset(queued.empty() ? nextFrame : queued.front().frame, target, towards);
+        if (direction != towards || std::abs(next) >= stride * (long long)maxQueuedFrames) {
+            restart(target, towards);
+        }
+        lock.unlock();
+        wake.notify_all();
+        return false;
+    }
+    for (auto skipped = queued.begin(); skipped != it; ++skipped) {
+        spare.push_back(std::move(skipped->positions));
+    }
+    std::swap(positions, it->positions);
+    spare.push_back(std::move(it->positions));
+    queued.erase(queued.begin(), it + 1);
+    if (direction != towards) {
+        restart(nextInDirection(target, towards, 1), towards);     // reversed: what is queued goes the wrong way
+    }
+    fetchedFrame = target;
+    lock.unlock();
+    wake.notify_all();
+    return true;
+}
+
+void trajectoryPlayer::run() {
+    traceRecorder::setThreadName("trajectory player");
+    while (true) {
+        long long frame;
+        long long frameGeneration;
+        int frameDirection;
+        particleStreams positions;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] {
+                return stopping || (queued.size() < maxQueuedFrames && nextFrame >= 0 && nextFrame < nFrames);
+            });
+            if (stopping) return;
+            frame = nextFrame;
+            frameGeneration = generation;
+            frameDirection = direction;
+            if (!spare.empty()) {
+                positions = std::move(spare.back());
+                spare.pop_back();
+            }
+        }
+
+        bool decoded = decodeFrame(frame, frameDirection < 0, positions);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (frameGeneration != generation) {
+            spare.push_back(std::move(positions));  // the playhead moved on meanwhile
+            continue;
+        }
+        if (decoded) {
+            queued.push_back({frame, std::move(positions)});
+        } else {
+            ofLogError("trajectoryPlayer") << "Frame " << frame << " is damaged, skipped";
+        }
+        nextFrame = nextInDirection(frame, direction, stride);
+    }
+}
+
+// Forward, the decoder carries on from the frame before; backwards, frames come out of the decoded keyframe group
+bool trajectoryPlayer::decodeFrame(long long frame, bool backwards, particleStreams& positions) {
+    traceRecorder::scope trace("decode frame");
+    const unsigned char* data = file.getData();
+    auto decodeNext = [&](particleStreams& target) {
+        long long decoding = decoderFrame + 1;
+        trajectoryFile::frameHeader header;
+        std::memcpy(&header, data + frameOffsets[size_t(decoding)], sizeof(header));
+        target.resize(nParticles);
+        if (!decoder.decode(data + frameOffsets[size_t(decoding)] + sizeof(header), header.bytes, header.keyframe != 0,
+                            target.x.data(), target.y.data())) {
+            decoderFrame = -1;
+            groupStart = -1;
+            return false;
+        }
+        decoderFrame = decoding;
+        return true;
+    };
+    long long keyframe = *(std::upper_bound(keyframes.begin(), keyframes.end(), frame) - 1);
+
+    if (!backwards) {
+        if (decoderFrame < keyframe - 1 || decoderFrame >= frame) {
+            decoderFrame = keyframe - 1;    // start from the keyframe
+        }
+        groupStart = -1;                    // decoding on invalidates the group
+        while (decoderFrame < frame) {
+            if (!decodeNext(positions)) return false;
+        }
+        return true;
+    }
+
+    if (groupStart != keyframe) {
+        groupStart = keyframe;
+        decoderFrame = keyframe - 1;
+    }
+    long long index = frame - groupStart;
+    if ((long long)groupFrames.size() <= index) groupFrames.resize(size_t(index + 1));
+    while (decoderFrame < frame) {
+        if (!decodeNext(groupFrames[size_t(decoderFrame + 1 - groupStart)])) return false;
+    }
+    const particleStreams& source = groupFrames[size_t(index)];
+    positions.x.assign(source.x.begin(), source.x.end());
+    positions.y.assign(source.y.begin(), source.y.end());
+#ifdef DYANTRA_PARTICLE_Z
+    positions.z.assign(nParticles, 0.0f);
+#endif
+    return true;
+}
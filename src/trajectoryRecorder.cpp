@@ -0,0 +1,140 @@
+#include "trajectoryRecorder.h"
+#include "trajectoryFile.h"
+#include "traceRecorder.h"
+#include "ofMain.h"
+#include <cstring>
+#include <fstream>
+
+bool trajectoryRecorder::start(const std::string& filePath, size_t particles, float quantization, int interval, int keyframes) {
+    stop();
+    if (particles == 0 || quantization <= 0) return false;
+
+    std::ofstream probe(filePath, std::ios::binary);   // fail here rather than on the I/O thread
+    if (!probe.is_open()) return false;
+    probe.close();
+
+    path = filePath;
+    nParticles = particles;
+    precision = quantization;
+    stepInterval = std::max(interval, 1);
+    keyframeInterval = std::max(keyframes, 1);
+    stepsSinceFrame = 0;
+    sizeMismatchLogged = false;
+    framesWritten = 0;
+    bytesWritten = 0;
+    stopping = false;
+    thread = std::thread(&trajectoryRecorder::run, this);
+    return true;
+}
+
+void trajectoryRecorder::stop() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    frameQueued.notify_all();
+    thread.join();
+    queued.clear();
+}
+
+void trajectoryRecorder::addStep(long long step, const particleStreams& positions) {
+    if (!isRecording()) return;
+    if (stepsSinceFrame++ % stepInterval != 0) return;
+    if (positions.size() != nParticles) {
+        if (!sizeMismatchLogged) {
+            ofLogError("trajectoryRecorder") << "Particle count changed from " << nParticles << " to "
+                                             << positions.size() << ", frames are no longer recorded";
+            sizeMismatchLogged = true;
+        }
+        return;
+    }
+
+    frame next;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        frameTaken.wait(lock, [&] { return queued.size() < maxQueuedFrames; });
+        if (!spareFrames.empty()) {
+            next = std::move(spareFrames.back());
+            spareFrames.pop_back();
+        }
+    }
+    next.step = step;
+    next.x.assign(positions.x.begin(), positions.x.end());
+    next.y.assign(positions.y.begin(), positions.y.end());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.push_back(std::move(next));
+    }
+    frameQueued.notify_one();
+}
+
+void trajectoryRecorder::run() {
+    traceRecorder::setThreadName("trajectory recorder");
+    std::ofstream file(path, std::ios::binary);
+
+    trajectoryFile::fileHeader header = {};
+    std::memcpy(header.magic, trajectoryFile::magic, sizeof(header.magic));
+    header.version = trajectoryFile::version;
+    header.byteOrder = trajectoryFile::byteOrderMark;
+    header.nParticles = nParticles;
+    header.precision = precision;
+    header.keyframeInterval = uint32_t(keyframeInterval);
+    header.stepInterval = uint32_t(stepInterval);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t offset = sizeof(header);
+
+    trajectoryFile::encoder encoder;
+    encoder.reset(nParticles, precision);
+    std::vector<trajectoryFile::keyframeEntry> keyframes;
+    std::vector<uint8_t> compressed;
+    uint64_t nFrames = 0;
+
+    while (true) {
+        frame current;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frameQueued.wait(lock, [&] { return stopping || !queued.empty(); });
+            if (queued.empty()) break;  // stopping, and everything is written
+            current = std::move(queued.front());
+            queued.pop_front();
+        }
+        frameTaken.notify_one();
+
+        traceRecorder::scope trace("record frame");
+        bool keyframe = nFrames % keyframeInterval == 0;
+        compressed.clear();
+        encoder.encode(current.x.data(), current.y.data(), keyframe, compressed);
+
+        trajectoryFile::frameHeader frameHeader = {};
+        frameHeader.marker = trajectoryFile::frameMarker;
+        frameHeader.bytes = uint32_t(compressed.size());
+        frameHeader.step = current.step;
+        frameHeader.keyframe = keyframe;
+        if (keyframe) keyframes.push_back({nFrames, offset});
+        file.write(reinterpret_cast<const char*>(&frameHeader), sizeof(frameHeader));
+        file.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+        offset += sizeof(frameHeader) + compressed.size();
+        ++nFrames;
+        framesWritten = nFrames;
+        bytesWritten = offset;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        spareFrames.push_back(std::move(current));
+    }
+
+    trajectoryFile::indexHeader index = {};
+    index.marker = trajectoryFile::indexMarker;
+    index.nFrames = nFrames;
+    index.nKeyframes = keyframes.size();
+    trajectoryFile::fileFooter footer = {};
+    footer.indexOffset = offset;
+    std::memcpy(footer.magic, trajectoryFile::footerMagic, sizeof(footer.magic));
+    file.write(reinterpret_cast<const char*>(&index), sizeof(index));
+    file.write(reinterpret_cast<const char*>(keyframes.data()), keyframes.size() * sizeof(trajectoryFile::keyframeEntry));
+    file.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    bytesWritten = offset + sizeof(index) + keyframes.size() * sizeof(trajectoryFile::keyframeEntry) + sizeof(footer);
+    if (!file) {
+        ofLogError("trajectoryRecorder") << "Writing " << path << " failed";
+    }
+}
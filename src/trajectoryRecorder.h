@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "particleStreams.h"
+
+// Appends particle positions to a .dytraj file (see trajectoryFile.h) while the simulation runs.
+// addStep copies the positions of every stepInterval-th step and returns; quantizing, compressing and writing
+// happen on the recorder's own I/O thread. At most maxQueuedFrames wait for it: past that addStep blocks rather
+// than drop a frame. start, stop and addStep are called from one thread at a time (or under one lock).
+class trajectoryRecorder {
+public:
+    static const char* extension() { return "dytraj"; }
+    static const size_t maxQueuedFrames = 16;
+
+    trajectoryRecorder() {}
+    ~trajectoryRecorder() { stop(); }
+
+    trajectoryRecorder(const trajectoryRecorder&) = delete;
+    trajectoryRecorder& operator=(const trajectoryRecorder&) = delete;
+
+    // path: a full path, see ofToDataPath; precision: pixels per quantization step
+    bool start(const std::string& path, size_t nParticles, float precision, int stepInterval, int keyframeInterval = 64);
+    void stop();    // writes what is queued, then the keyframe index
+    bool isRecording() const { return thread.joinable(); }
+
+    // After every step; 'step' is stored with the frame (timeReversalSchedule::elapsedTimesteps).
+    // Frames with a different particle count than the recording started with are dropped.
+    void addStep(long long step, const particleStreams& positions);
+
+    long long getFramesWritten() const { return framesWritten; }
+    long long getBytesWritten() const { return bytesWritten; }
+    size_t getParticleCount() const { return nParticles; }
+
+private:
+    struct frame {
+        long long step;
+        std::vector<float> x;
+        std::vector<float> y;
+    };
+    void run();
+
+    std::string path;
+    size_t nParticles = 0;
+    float precision = 0.01f;
+    int stepInterval = 1;
+    int keyframeInterval = 64;
+    long long stepsSinceFrame = 0;
+    bool sizeMismatchLogged = false;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable frameQueued;
+    std::condition_variable frameTaken;
+    std::deque<frame> queued;
+    std::vector<frame> spareFrames;     // written frames, reused so recording does not allocate
+    bool stopping = false;
+
+    std::atomic<long long> framesWritten{0};
+    std::atomic<long long> bytesWritten{0};
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free hand-over of a value from one writer to one reader, e.g. particle positions from the simulation thread
+// to draw(). The writer fills its own slot and publishes it, the reader takes the newest published slot; a third slot
+// sits between them, so neither side ever waits for the other or sees a half-written value.
+// Writes must come from one thread at a time (one thread, or several taking turns under the same lock).
+template <class T>
+class tripleBuffer {
+public:
+    // The slot the writer fills; publish() hands it to the reader and gives the writer a free slot.
+    // The new slot holds an older value, so a writer that needs the current value copies it in first.
+    T& writeBuffer() { return slots[writeIndex]; }
+
+    void publish() {
+        int previous = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel);
+        writeIndex = previous & indexMask;
+    }
+
+    // Takes the newest published value, if there is one the reader has not seen; returns whether it did
+    bool acquire() {
+        if (!(middle.load(std::memory_order_relaxed) & freshBit)) return false;
+        int previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & indexMask;
+        return true;
+    }
+
+    const T& readBuffer() const { return slots[readIndex]; }
+
+    // True while the last published value waits for acquire(); the writer can skip publishing until then
+    bool isPending() const { return middle.load(std::memory_order_acquire) & freshBit; }
+
+private:
+    static const int indexMask = 3;
+    static const int freshBit = 4;
+
+    T slots[3];
+    int writeIndex = 0;             // writer only
+    int readIndex = 1;              // reader only
+    std::atomic<int> middle{2};     // slot in between, plus freshBit when it holds an unread value
+};
@@ -0,0 +1,126 @@
+#include "workerPool.h"
+#include "traceRecorder.h"
+#include <algorithm>
+
+namespace {
+    thread_local const workerPool* runningPool = nullptr;   // the pool whose loop this thread is working on
+}
+
+workerPool::workerPool(int nThreads) {
+    setThreadCount(nThreads);
+}
+
+workerPool::~workerPool() {
+    stopWorkers();
+}
+
+int workerPool::hardwareThreads() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return n > 0 ? int(n) : 1;
+}
+
+void workerPool::setThreadCount(int nThreads) {
+    if (nThreads <= 0) nThreads = hardwareThreads();
+    std::lock_guard<std::mutex> dispatch(dispatchMutex);
+    if (nThreads == threadCount && int(workers.size()) == nThreads - 1) return;
+    stopWorkers();
+    threadCount = nThreads;
+    startWorkers(nThreads - 1);  // the calling thread is the last worker
+}
+
+void workerPool::startWorkers(int nWorkers) {
+    stopping = false;
+    workers.reserve(nWorkers);
+    for (int i = 0; i < nWorkers; ++i) {
+        workers.emplace_back(&workerPool::workerLoop, this, generation);
+    }
+}
+
+void workerPool::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+// seenGeneration is handed over at creation: reading it from the thread could miss a job dispatched before the thread got going
+void workerPool::workerLoop(uint64_t seenGeneration) {
+    traceRecorder::setThreadName("worker");
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+        }
+        runChunks();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --busyWorkers;
+        }
+        doneCondition.notify_one();
+    }
+}
+
+void workerPool::runChunks() {
+    traceRecorder::scope trace("parallelFor");
+    const workerPool* outerPool = runningPool;
+    runningPool = this;
+    size_t chunk;
+    while ((chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) < jobChunks) {
+        size_t begin = chunk * jobChunkSize;
+        size_t end = std::min(begin + jobChunkSize, jobCount);
+        (*job)(begin, end);
+    }
+    runningPool = outerPool;
+}
+
+void workerPool::parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& job) {
+    if (count == 0) return;
+    chunkSize = std::max<size_t>(chunkSize, 1);
+
+    // A nested call from inside one of this pool's chunks: the workers are taken, and dispatchMutex may be ours already
+    if (runningPool == this) {
+        job(0, count);
+        return;
+    }
+
+    // Not worth waking anybody up, or the workers are busy with another thread's loop
+    std::unique_lock<std::mutex> dispatch(dispatchMutex, std::try_to_lock);
+    if (!dispatch.owns_lock() || workers.empty() || count <= chunkSize) {
+        job(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->job = &job;
+        jobCount = count;
+        jobChunkSize = chunkSize;
+        jobChunks = (count + chunkSize - 1) / chunkSize;
+        nextChunk.store(0, std::memory_order_relaxed);
+        busyWorkers = int(workers.size());
+        ++generation;
+    }
+    wakeCondition.notify_all();
+
+    runChunks();
+
+    traceRecorder::scope trace("parallelFor wait");   // time the caller spends waiting for the slowest worker
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [&] { return busyWorkers == 0; });
+    this->job = nullptr;
+}
+
+void workerPool::parallelFor(workerPool* pool, size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& job) {
+    if (pool) {
+        pool->parallelFor(count, chunkSize, job);
+    } else if (count > 0) {
+        job(0, count);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool of worker threads for data-parallel loops over the particle streams.
+// The threads are created once and sleep between calls, so dispatching a step costs a wake-up, not a thread spawn.
+// One pool is shared by everything that runs in parallel (see particleEnsemble::getWorkerPool), so the thread count
+// set for the simulation is the only one there is.
+class workerPool {
+public:
+    explicit workerPool(int nThreads = 0);  // 0 = one thread per hardware core
+    ~workerPool();
+
+    workerPool(const workerPool&) = delete;
+    workerPool& operator=(const workerPool&) = delete;
+
+    // Total number of threads working on a parallelFor, including the calling thread
+    void setThreadCount(int nThreads);
+    int getThreadCount() const { return threadCount; }
+
+    // Calls job(begin, end) for consecutive chunks of [0, count) and returns once every chunk is done.
+    // Chunks are handed out dynamically, so a slow core does not hold up the others.
+    // While another thread's parallelFor holds the workers, or when called from inside a chunk of this pool's own
+    // parallelFor, the loop runs on the calling thread alone.
+    void parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& job);
+
+    // pool->parallelFor, or the whole loop on the calling thread when there is no pool
+    static void parallelFor(workerPool* pool, size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& job);
+
+    static int hardwareThreads();
+
+private:
+    void startWorkers(int nWorkers);
+    void stopWorkers();
+    void workerLoop(uint64_t seenGeneration);
+    void runChunks();
+
+    std::vector<std::thread> workers;
+    int threadCount = 1;
+
+    std::mutex dispatchMutex;    // held by the parallelFor that owns the workers
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+    uint64_t generation = 0;    // bumped for every parallelFor, wakes the workers
+    int busyWorkers = 0;
+    bool stopping = false;
+
+    // current job
+    const std::function<void(size_t, size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    size_t jobChunkSize = 1;
+    size_t jobChunks = 0;
+    std::atomic<size_t> nextChunk{0};
+};